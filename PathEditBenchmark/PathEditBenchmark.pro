@@ -0,0 +1,15 @@
+TEMPLATE = app
+
+QT += widgets testlib
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+TARGET = tst_patheditbenchmark
+
+SOURCES += \
+	tst_patheditbenchmark.cpp
+
+system(qpmx -d $$shell_quote($$_PRO_FILE_PWD_/..) --qmake-run init $$QPMX_EXTRA_OPTIONS $$shell_quote($$QMAKE_QMAKE) $$shell_quote($$OUT_PWD)):include($$OUT_PWD/qpmx_generated.pri)
+else: error(qpmx initialization failed. Check the compilation log for details.)
+
+include(../qpathedit.pri)
@@ -0,0 +1,483 @@
+#include <QApplication>
+#include <QDir>
+#include <QDropEvent>
+#include <QFile>
+#include <QLineEdit>
+#include <QMimeData>
+#include <QPainter>
+#include <QStandardItemModel>
+#include <QTemporaryDir>
+#include <QUrl>
+#include <QtTest>
+#include <qpathedit.h>
+#include <qpatheditdelegate.h>
+#include <qpathedit_p.h>
+
+//gives the tests access to the colors the delegate paints with
+class StyleOptionDelegate : public QPathEditDelegate
+{
+public:
+	using QPathEditDelegate::QPathEditDelegate;
+	using QPathEditDelegate::initStyleOption;
+};
+
+class PathEditBenchmark : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+
+	void validate_data();
+	void validate();
+	void typing_data();
+	void typing();
+	void listCompletion();
+	void validateBatch_data();
+	void validateBatch();
+	void validateMemory_data();
+	void validateMemory();
+	void setPath_data();
+	void setPath();
+	void setManyPaths();
+	void nameFilters_data();
+	void nameFilters();
+	void mimeTypes_data();
+	void mimeTypes();
+	void drop_data();
+	void drop();
+	void dragOver_data();
+	void dragOver();
+	void delegatePaint_data();
+	void delegatePaint();
+	void defaultIcon();
+	void construction_data();
+	void construction();
+
+private:
+	QTemporaryDir tmpDir;
+	QHash<QByteArray, QString> trees;
+
+	void addTreeColumns();
+	static QString entryPath(const QString &tree, int index);
+};
+
+void PathEditBenchmark::initTestCase()
+{
+	QVERIFY(tmpDir.isValid());
+	QDir root(tmpDir.path());
+
+	//every tenth entry is a directory, all others are files with alternating suffixes
+	static const char *suffixes[] = {"txt", "png", "cpp", "tar.gz"};
+	QList<QPair<QByteArray, int>> sizes = {
+		{"10", 10},
+		{"10k", 10000},
+		{"100k", 100000}
+	};
+	foreach(auto size, sizes) {
+		QString treeName = QStringLiteral("tree_") + QString::fromLatin1(size.first);
+		QVERIFY(root.mkdir(treeName));
+		QString treePath = root.absoluteFilePath(treeName);
+		for(int i = 0; i < size.second; ++i) {
+			if(i % 10 == 0)
+				QVERIFY(QDir(treePath).mkdir(QStringLiteral("dir_%1").arg(i, 6, 10, QLatin1Char('0'))));
+			else {
+				QFile file(entryPath(treePath, i) + QLatin1Char('.') + QLatin1String(suffixes[i % 4]));
+				QVERIFY(file.open(QIODevice::WriteOnly));
+			}
+		}
+		trees.insert(size.first, treePath);
+	}
+}
+
+void PathEditBenchmark::validate_data()
+{
+	QTest::addColumn<QString>("path");
+	QTest::addColumn<QPathEdit::PathMode>("mode");
+	QTest::addColumn<bool>("cached");
+
+	for(auto it = trees.constBegin(); it != trees.constEnd(); ++it) {
+		QString file = entryPath(it.value(), 5) + QStringLiteral(".png");
+		QString missing = it.value() + QStringLiteral("/missing/file.txt");
+		foreach(bool cached, QList<bool>({false, true})) {
+			QByteArray suffix = cached ? "-cached" : "-uncached";
+			QTest::newRow((it.key() + "-file" + suffix).constData()) << file << QPathEdit::ExistingFile << cached;
+			QTest::newRow((it.key() + "-folder" + suffix).constData()) << it.value() << QPathEdit::ExistingFolder << cached;
+			QTest::newRow((it.key() + "-missing" + suffix).constData()) << missing << QPathEdit::AnyFile << cached;
+		}
+	}
+}
+
+void PathEditBenchmark::validate()
+{
+	QFETCH(QString, path);
+	QFETCH(QPathEdit::PathMode, mode);
+	QFETCH(bool, cached);
+
+	int oldSize = QPathEdit::statCacheSize();
+	QPathEdit::setStatCacheSize(cached ? oldSize : 0);
+
+	PathValidator validator(nullptr);
+	validator.setMode(mode);
+	int pos = 0;
+	QBENCHMARK {
+		validator.validate(path, pos);
+	}
+
+	QPathEdit::setStatCacheSize(oldSize);
+}
+
+void PathEditBenchmark::typing_data()
+{
+	addTreeColumns();
+}
+
+void PathEditBenchmark::typing()
+{
+	QFETCH(QString, tree);
+
+	//every keystroke within the name only changes the last segment
+	QString path = entryPath(tree, 1) + QStringLiteral(".png");
+	QStringList keystrokes;
+	for(int i = tree.size() + 1; i <= path.size(); ++i)
+		keystrokes.append(path.left(i));
+
+	int oldSize = QPathEdit::statCacheSize();
+	QPathEdit::setStatCacheSize(0);
+	PathValidator validator(nullptr);
+	int pos = 0;
+	QValidator::State state = QValidator::Invalid;
+	QBENCHMARK {
+		foreach(QString text, keystrokes)
+			state = validator.validate(text, pos);
+	}
+	QPathEdit::setStatCacheSize(oldSize);
+	QCOMPARE(state, QValidator::Acceptable);
+}
+
+void PathEditBenchmark::listCompletion()
+{
+	//the list backend has to follow the typed text into subdirectories, not only list the first one
+	const QString tree = trees.value("10");
+	QPathEdit edit(QPathEdit::ExistingFile);
+	edit.setCompleterBackend(QPathEdit::DirectoryListBackend);
+	edit.setCompletionDelay(0);
+	QLineEdit *lineEdit = edit.findChild<QLineEdit*>();
+	QVERIFY(lineEdit);
+
+	QTest::keyClicks(lineEdit, tree + QStringLiteral("/entry"));
+	DirectoryListModel *model = edit.findChild<DirectoryListModel*>();
+	QVERIFY(model);
+	QCOMPARE(model->directory(), tree);
+
+	lineEdit->clear();
+	QTest::keyClicks(lineEdit, tree + QStringLiteral("/dir_000000/e"));
+	QCOMPARE(model->directory(), tree + QStringLiteral("/dir_000000"));
+}
+
+void PathEditBenchmark::validateBatch_data()
+{
+	QTest::addColumn<int>("count");
+	QTest::newRow("10") << 10;
+	QTest::newRow("1000") << 1000;
+	QTest::newRow("10000") << 10000;
+}
+
+void PathEditBenchmark::validateBatch()
+{
+	QFETCH(int, count);
+
+	static const char *suffixes[] = {"txt", "png", "cpp", "tar.gz"};
+	QStringList paths;
+	for(int i = 1; paths.size() < count; ++i) {
+		if(i % 10 != 0)
+			paths.append(entryPath(trees.value("100k"), i) + QLatin1Char('.') + QLatin1String(suffixes[i % 4]));
+	}
+
+	int oldSize = QPathEdit::statCacheSize();
+	QPathEdit::setStatCacheSize(0);
+	QPathValidation validation(QPathValidation::ExistingFiles);
+	QVector<QPathValidation::State> states;
+	QBENCHMARK {
+		states = validation.validate(paths);
+	}
+	QPathEdit::setStatCacheSize(oldSize);
+
+	QCOMPARE(states.size(), count);
+	QVERIFY(!states.contains(QPathValidation::Intermediate));
+}
+
+void PathEditBenchmark::validateMemory_data()
+{
+	validateBatch_data();
+}
+
+void PathEditBenchmark::validateMemory()
+{
+	QFETCH(int, count);
+
+	//the same kind of tree as on disk, but without any syscalls
+	QSharedPointer<QPathMemoryFileSystemProvider> provider(new QPathMemoryFileSystemProvider());
+	QStringList paths;
+	for(int i = 1; paths.size() < count; ++i) {
+		QString path = QStringLiteral("/tree/entry_%1.txt").arg(i, 6, 10, QLatin1Char('0'));
+		provider->addFile(path);
+		paths.append(path);
+	}
+
+	QPathValidation validation(QPathValidation::ExistingFiles);
+	validation.setFileSystemProvider(provider);
+	QVector<QPathValidation::State> states;
+	QBENCHMARK {
+		states = validation.validate(paths);
+	}
+
+	QCOMPARE(states.size(), count);
+	QVERIFY(!states.contains(QPathValidation::Intermediate));
+}
+
+void PathEditBenchmark::setPath_data()
+{
+	addTreeColumns();
+}
+
+void PathEditBenchmark::setPath()
+{
+	QFETCH(QString, tree);
+
+	QPathEdit edit(QPathEdit::ExistingFile);
+	QString first = entryPath(tree, 1) + QStringLiteral(".png");
+	QString second = entryPath(tree, 2) + QStringLiteral(".cpp");
+	//alternates between two paths, as setting the same path twice is a no-op
+	QBENCHMARK {
+		edit.setPath(first);
+		edit.setPath(second);
+	}
+	QCOMPARE(edit.path(), second);
+}
+
+void PathEditBenchmark::setManyPaths()
+{
+	//far more text than the default length limit of a QLineEdit
+	static const char *suffixes[] = {"txt", "png", "cpp", "tar.gz"};
+	QStringList paths;
+	for(int i = 1; paths.size() < 2000; ++i) {
+		if(i % 10 != 0)
+			paths.append(entryPath(trees.value("10k"), i) + QLatin1Char('.') + QLatin1String(suffixes[i % 4]));
+	}
+
+	QPathEdit edit(QPathEdit::ExistingFiles);
+	QVERIFY(paths.join(edit.pathSeparator()).size() > 64 * 1024);
+	QVERIFY(edit.setPaths(paths));
+	QCOMPARE(edit.paths(), paths);
+}
+
+void PathEditBenchmark::nameFilters_data()
+{
+	addTreeColumns();
+}
+
+void PathEditBenchmark::nameFilters()
+{
+	QFETCH(QString, tree);
+
+	QStringList filters = {
+		QStringLiteral("Images (*.png *.jpg *.bmp)"),
+		QStringLiteral("Sources (*.cpp *.h)"),
+		QStringLiteral("Archives (*.tar.gz *.zip)"),
+		QStringLiteral("Backups (backup_[0-9]*)")
+	};
+	QStringList names = QDir(tree).entryList(QDir::Files);
+
+	QPathEdit edit;
+	int matches = 0;
+	QBENCHMARK {
+		edit.setNameFilters(filters);
+		NameFilterMatcher matcher(filters);
+		matches = 0;
+		foreach(const QString &name, names) {
+			if(matcher.matches(name))
+				++matches;
+		}
+	}
+	QVERIFY(matches > 0);
+}
+
+void PathEditBenchmark::mimeTypes_data()
+{
+	addTreeColumns();
+}
+
+void PathEditBenchmark::mimeTypes()
+{
+	QFETCH(QString, tree);
+
+	//the first round sniffs the contents, all later ones only need a stat per file
+	static const char *suffixes[] = {"txt", "png", "cpp", "tar.gz"};
+	QStringList files;
+	for(int i = 1; i < 10; ++i)
+		files.append(entryPath(tree, i) + QLatin1Char('.') + QLatin1String(suffixes[i % 4]));
+	const QStringList filters = {QStringLiteral("image/png"), QStringLiteral("text/plain")};
+	QBENCHMARK {
+		foreach(const QString &file, files)
+			MimeTypeCache::instance()->matches(file, filters);
+	}
+	QVERIFY(!MimeTypeCache::instance()->mimeType(files.first()).isNull());
+}
+
+void PathEditBenchmark::drop_data()
+{
+	addTreeColumns();
+}
+
+void PathEditBenchmark::drop()
+{
+	QFETCH(QString, tree);
+
+	QPathEdit edit(QPathEdit::ExistingFile);
+	edit.setNameFilters({QStringLiteral("Images (*.png *.jpg)"), QStringLiteral("Sources (*.cpp)")});
+	QLineEdit *lineEdit = edit.findChild<QLineEdit*>();
+	QVERIFY(lineEdit);
+
+	QMimeData firstData;
+	firstData.setUrls({QUrl::fromLocalFile(entryPath(tree, 1) + QStringLiteral(".png"))});
+	QMimeData secondData;
+	secondData.setUrls({QUrl::fromLocalFile(entryPath(tree, 2) + QStringLiteral(".cpp"))});
+
+	QBENCHMARK {
+		QDropEvent firstEvent(QPointF(), Qt::CopyAction, &firstData, Qt::LeftButton, Qt::NoModifier);
+		QCoreApplication::sendEvent(lineEdit, &firstEvent);
+		QDropEvent secondEvent(QPointF(), Qt::CopyAction, &secondData, Qt::LeftButton, Qt::NoModifier);
+		QCoreApplication::sendEvent(lineEdit, &secondEvent);
+	}
+	QCOMPARE(edit.path(), secondData.urls().first().toLocalFile());
+}
+
+void PathEditBenchmark::dragOver_data()
+{
+	addTreeColumns();
+}
+
+void PathEditBenchmark::dragOver()
+{
+	QFETCH(QString, tree);
+
+	QPathEdit edit(QPathEdit::ExistingFile);
+	edit.setNameFilters({QStringLiteral("Images (*.png *.jpg)"), QStringLiteral("Sources (*.cpp)")});
+	QLineEdit *lineEdit = edit.findChild<QLineEdit*>();
+	QVERIFY(lineEdit);
+
+	QMimeData data;
+	data.setUrls({QUrl::fromLocalFile(entryPath(tree, 1) + QStringLiteral(".png"))});
+
+	//one drag session with many moves, as the edit gets them while hovering
+	bool accepted = false;
+	QBENCHMARK {
+		QDragEnterEvent enterEvent(QPoint(), Qt::CopyAction, &data, Qt::LeftButton, Qt::NoModifier);
+		QCoreApplication::sendEvent(lineEdit, &enterEvent);
+		for(int i = 0; i < 100; ++i) {
+			QDragMoveEvent moveEvent(QPoint(i, 0), Qt::CopyAction, &data, Qt::LeftButton, Qt::NoModifier);
+			QCoreApplication::sendEvent(lineEdit, &moveEvent);
+			accepted = moveEvent.isAccepted();
+		}
+		QDragLeaveEvent leaveEvent;
+		QCoreApplication::sendEvent(lineEdit, &leaveEvent);
+	}
+	QVERIFY(accepted);
+}
+
+void PathEditBenchmark::delegatePaint_data()
+{
+	addTreeColumns();
+}
+
+void PathEditBenchmark::delegatePaint()
+{
+	QFETCH(QString, tree);
+
+	//one screen of a table column, painted without any editor widget
+	static const char *suffixes[] = {"txt", "png", "cpp", "tar.gz"};
+	QStandardItemModel model(50, 1);
+	for(int i = 0; i < model.rowCount(); ++i)
+		model.setData(model.index(i, 0), entryPath(tree, i + 1) + QLatin1Char('.') + QLatin1String(suffixes[(i + 1) % 4]));
+
+	StyleOptionDelegate delegate(QPathEdit::ExistingFile);
+	QImage image(400, 20, QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	QStyleOptionViewItem option;
+	option.rect = image.rect();
+	//the first paint queues the cells, the benchmark then paints them from the validated states
+	for(int i = 0; i < model.rowCount(); ++i)
+		delegate.paint(&painter, option, model.index(i, 0));
+	QCoreApplication::processEvents();
+	QThreadPool::globalInstance()->waitForDone();
+	QCoreApplication::processEvents();
+
+	//the tenth entry is a directory, so the file in the tenth row does not exist
+	auto textColor = [&](int row){
+		QStyleOptionViewItem cellOption = option;
+		delegate.initStyleOption(&cellOption, model.index(row, 0));
+		return cellOption.palette.color(QPalette::Text);
+	};
+	QTRY_VERIFY(textColor(0) != textColor(9));
+
+	QBENCHMARK {
+		for(int i = 0; i < model.rowCount(); ++i)
+			delegate.paint(&painter, option, model.index(i, 0));
+	}
+}
+
+void PathEditBenchmark::defaultIcon()
+{
+	QPathEdit edit;
+	QBENCHMARK {
+		edit.setStyle(QPathEdit::JoinedButton);
+		edit.setStyle(QPathEdit::SeperatedButton);
+		edit.resetDialogButtonIcon();
+	}
+	QVERIFY(!edit.dialogButtonIcon().isNull());
+}
+
+void PathEditBenchmark::construction_data()
+{
+	QTest::addColumn<int>("count");
+	QTest::newRow("1") << 1;
+	QTest::newRow("10") << 10;
+	QTest::newRow("100") << 100;
+}
+
+void PathEditBenchmark::construction()
+{
+	QFETCH(int, count);
+
+	QBENCHMARK {
+		QWidget parent;
+		for(int i = 0; i < count; ++i)
+			new QPathEdit(&parent);
+		QCOMPARE(parent.findChildren<QPathEdit*>(QString(), Qt::FindDirectChildrenOnly).size(), count);
+	}
+}
+
+void PathEditBenchmark::addTreeColumns()
+{
+	QTest::addColumn<QString>("tree");
+	for(auto it = trees.constBegin(); it != trees.constEnd(); ++it)
+		QTest::newRow(it.key().constData()) << it.value();
+}
+
+QString PathEditBenchmark::entryPath(const QString &tree, int index)
+{
+	return tree + QStringLiteral("/entry_%1").arg(index, 6, 10, QLatin1Char('0'));
+}
+
+int main(int argc, char *argv[])
+{
+	//the benchmarks must run on build servers without a display
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	QApplication app(argc, argv);
+	PathEditBenchmark benchmark;
+	return QTest::qExec(&benchmark, argc, argv);
+}
+
+#include "tst_patheditbenchmark.moc"
@@ -55,6 +55,9 @@ void Form::on_pathModeComboBox_activated(int index)
 	case 2:
 		ui->pathedit->setPathMode(QPathEdit::AnyFile);
 		break;
+	case 3:
+		ui->pathedit->setPathMode(QPathEdit::ExistingFiles);
+		break;
 	default:
 		break;
 	}
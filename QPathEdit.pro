@@ -2,7 +2,8 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     QPathEditPlugin \
-    PathEditTest
+    PathEditTest \
+    PathEditBenchmark
 
 DISTFILES += \
 	README.md \
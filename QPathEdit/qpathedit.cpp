@@ -1,39 +1,51 @@
 #include "qpathedit.h"
+#include "qpathedit_p.h"
 
 #include <QAction>
-#include <QCompleter>
+#include <QCoreApplication>
+#include <QDirIterator>
 #include <QDropEvent>
 #include <QEvent>
-#include <QFileSystemModel>
+#include <QFileIconProvider>
+#include <QFutureWatcher>
 #include <QHBoxLayout>
 #include <QKeyEvent>
 #include <QLineEdit>
+#include <QListView>
 #include <QMimeData>
+#include <QMimeDatabase>
 #include <QPainter>
-#include <QRegularExpression>
 #include <QRegularExpressionMatch>
 #include <QStandardPaths>
+#include <QThreadPool>
 #include <QTimer>
 #include <QToolButton>
 #include <QUrl>
-#include <QValidator>
+#include <QtConcurrent>
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <dialogmaster.h>
 
-//HELPER CLASSES
+Q_GLOBAL_STATIC(QThreadPool, listingPool)
+Q_GLOBAL_STATIC(QThreadPool, prefetchPool)
+Q_GLOBAL_STATIC(QThreadPool, iconPool)
+typedef QHash<QPathFileSystemProvider*, QWeakPointer<DirectoryLister>> ListerHash;
+Q_GLOBAL_STATIC(ListerHash, sharedListers)
 
-class PathValidator : public QValidator
-{
-public:
-	PathValidator(QObject *parent);
-	void setMode(QPathEdit::PathMode mode);
-	void setAllowEmpty(bool allow);
-	State validate(QString &text, int &) const override;
-private:
-	QPathEdit::PathMode mode;
-	bool allowEmpty;
-};
+//the shared directory listings are dropped beyond this number of entries
+static const int MaxCachedEntries = 500000;
+
+Q_STATIC_ASSERT(static_cast<int>(QPathEdit::ExistingFiles) == static_cast<int>(QPathValidation::ExistingFiles));
+Q_STATIC_ASSERT(static_cast<int>(QValidator::Acceptable) == static_cast<int>(QPathValidation::Acceptable));
+
+static QPathEdit::ValidationState toValidationState(QPathValidation::State state);
+static QIcon entryTypeIcon(quint8 type);
+static QHash<DefaultIconKey, QIcon> &defaultIconCache();
+static void clearThemeIcons();
+static quint64 fuzzyCharMask(const QString &text);
+static int fuzzyScore(const QString &pattern, const QString &lowerPattern, const QString &name);
 
 //QPATHEDIT IMPLEMENTATION
 
@@ -44,82 +56,111 @@ QPathEdit::QPathEdit(QWidget *parent, QPathEdit::Style style) :
 QPathEdit::QPathEdit(QPathEdit::PathMode pathMode, QWidget *parent, QPathEdit::Style style) :
 	QWidget(parent),
 	edit(new QLineEdit(this)),
-	pathCompleter(new QCompleter(this)),
-	completerModel(new QFileSystemModel(this)),
+	pathCompleter(nullptr),
+	completerModel(nullptr),
+	listModel(nullptr),
+	completionTimer(nullptr),
+	completionInterval(100),
+	completionDir(),
 	pathValidator(new PathValidator(this)),
-	dialog(new QFileDialog(this)),
+	dialog(nullptr),
+	dialogFileSelected(false),
+	perfCounters(),
+	loadTimer(),
 	currentValidPath(),
 	wasPathValid(true),
+	valState(Valid),
+	entryStates(),
+	asyncValidate(false),
+	commitPending(false),
 	uiStyle(style),
 	mode(ExistingFile),
 	defaultDir(QStandardPaths::writableLocation(QStandardPaths::HomeLocation)),
 	allowEmpty(true),
-	toolButton(new QToolButton(this)),
+	dlgOptions(),
+	nameFilterList(),
+	mimeFilterList(),
+	mimeFiltersActive(false),
+	filterMatcher(new NameFilterMatcher()),
+	validateFilters(false),
+	validateMimes(false),
+	mimeVerdicts(),
+	mimeGeneration(0),
+	setPathGeneration(0),
+	completerEnabled(true),
+	completerBackendType(FileSystemBackend),
+	completionModeType(PrefixCompletion),
+	iconMode(FileIcons),
+	fuzzyLimit(50),
+	prefetchCount(0),
+	separator(QLatin1Char(';')),
+	fsProvider(),
+	dragActive(false),
+	dragAccepted(false),
+	dragPaths(),
+	dragGeneration(0),
+	watchEnabled(false),
+	watchTimer(nullptr),
+	watchProvider(),
+	watchConnection(),
+	watchedPaths(),
+	watchedTypes(),
+	watchedDirs(),
+	toolButton(nullptr),
 	dialogAction(new QAction(getDefaultIcon(), tr("Open File-Dialog"), this)),
 	hasCustomIcon(false)
 {
-	//setup dialog
-	dialog->setOptions(0);
-	DialogMaster::masterDialog(dialog);
+	//dialog and completer are created on first use, only the mode is stored for now
 	setPathMode(pathMode);
-	connect(dialog, &QFileDialog::fileSelected, this, &QPathEdit::dialogFileSelected);
-
-	//setup completer
-    completerModel->setRootPath(QString());
-	completerModel->setNameFilterDisables(false);
-	connect(completerModel, &QFileSystemModel::directoryLoaded, pathCompleter, [this](QString){
-		pathCompleter->complete();
-	});
-	pathCompleter->setModel(completerModel);
 
 	//setup this
 	QHBoxLayout *layout = new QHBoxLayout(this);
 	layout->setContentsMargins(QMargins());
 	layout->setSpacing(0);
 	layout->addWidget(edit);
-	layout->addWidget(toolButton);
 	setLayout(layout);
 	//setup lineedit
 	edit->installEventFilter(this);
-	edit->setCompleter(pathCompleter);
 	edit->setValidator(pathValidator);
 	edit->setDragEnabled(true);
 	edit->setReadOnly(true);
 	connect(edit, &QLineEdit::editingFinished, this, &QPathEdit::editTextUpdate);
 	connect(edit, &QLineEdit::textChanged, this, &QPathEdit::updateValidInfo);
+	connect(edit, &QLineEdit::textEdited, this, &QPathEdit::initCompleter);
+	connect(pathValidator, &PathValidator::asyncValidated, this, &QPathEdit::asyncValidated);
+	connect(this, &QPathEdit::pathChanged, this, &QPathEdit::updatePathWatch);
 	//setup "button"
 	connect(dialogAction, &QAction::triggered, this, &QPathEdit::showDialog);
-	toolButton->setDefaultAction(dialogAction);
-	int height = edit->sizeHint().height();
-#ifdef Q_OS_WIN
-	height += 2;
-#endif
-	toolButton->setFixedSize(height, height);
-	QT_WARNING_PUSH
-	QT_WARNING_DISABLE_GCC("-Wimplicit-fallthrough")
 	switch(style) {
+	case SeperatedButton:
+		initToolButton();
+		break;
 	case JoinedButton:
 		edit->addAction(dialogAction, QLineEdit::TrailingPosition);
-	case NoButton:
-		toolButton->setVisible(false);
 		break;
 	default:
 		break;
 	}
-	QT_WARNING_POP
 
-	QWidget::setTabOrder(edit, toolButton);
 	setFocusPolicy(edit->focusPolicy());
 	setFocusProxy(edit);
 	setAcceptDrops(true);
 }
 
-QPathEdit::QPathEdit(QPathEdit::PathMode pathMode, QString defaultDirectory, QWidget *parent, QPathEdit::Style style) :
+QPathEdit::QPathEdit(QPathEdit::PathMode pathMode, const QString &defaultDirectory, QWidget *parent, QPathEdit::Style style) :
 	QPathEdit(pathMode, parent, style)
 {
 	setDefaultDirectory(defaultDirectory);
 }
 
+QPathEdit::~QPathEdit()
+{
+	//releases the watched directories
+	watchEnabled = false;
+	updatePathWatch();
+	releaseDialog();
+}
+
 QPathEdit::PathMode QPathEdit::pathMode() const
 {
 	return mode;
@@ -127,26 +168,40 @@ QPathEdit::PathMode QPathEdit::pathMode() const
 
 void QPathEdit::setPathMode(PathMode pathMode)
 {
+	bool multiChanged = (mode == ExistingFiles) != (pathMode == ExistingFiles);
 	mode = pathMode;
 	pathValidator->setMode(pathMode);
+	updateCompleterFilters();
 	currentValidPath.clear();
 	emit pathChanged(QString());
 	edit->clear();
-	switch(pathMode) {
+	//the default limit of 32767 characters would silently cut off long lists of paths
+	edit->setMaxLength(pathMode == ExistingFiles ? std::numeric_limits<int>::max() : 32767);
+	if(dialog)
+		updateDialogMode();
+	//multiple paths can only be completed by the list backend
+	if(multiChanged)
+		resetCompleter();
+}
+
+void QPathEdit::updateDialogMode()
+{
+	switch(mode) {
 	case ExistingFile:
 		dialog->setAcceptMode(QFileDialog::AcceptOpen);
 		dialog->setFileMode(QFileDialog::ExistingFile);
-		completerModel->setFilter(QDir::AllEntries | QDir::AllDirs | QDir::NoDotAndDotDot);
 		break;
 	case ExistingFolder:
 		dialog->setAcceptMode(QFileDialog::AcceptOpen);
 		dialog->setFileMode(QFileDialog::Directory);
-		completerModel->setFilter(QDir::Drives | QDir::Dirs | QDir::NoDotAndDotDot);
 		break;
 	case AnyFile:
 		dialog->setAcceptMode(QFileDialog::AcceptSave);
 		dialog->setFileMode(QFileDialog::AnyFile);
-		completerModel->setFilter(QDir::AllEntries | QDir::AllDirs | QDir::NoDotAndDotDot);
+		break;
+	case ExistingFiles:
+		dialog->setAcceptMode(QFileDialog::AcceptOpen);
+		dialog->setFileMode(QFileDialog::ExistingFiles);
 		break;
 	default:
 		Q_UNREACHABLE();
@@ -155,12 +210,14 @@ void QPathEdit::setPathMode(PathMode pathMode)
 
 QFileDialog::Options QPathEdit::dialogOptions() const
 {
-	return dialog->options();
+	return dlgOptions;
 }
 
 void QPathEdit::setDialogOptions(QFileDialog::Options dialogOptions)
 {
-	dialog->setOptions(dialogOptions);
+	dlgOptions = dialogOptions;
+	if(dialog)
+		dialog->setOptions(dialogOptions);
 }
 
 bool QPathEdit::isEmptyPathAllowed() const
@@ -179,7 +236,7 @@ QString QPathEdit::defaultDirectory() const
 	return defaultDir;
 }
 
-void QPathEdit::setDefaultDirectory(QString defaultDirectory)
+void QPathEdit::setDefaultDirectory(const QString &defaultDirectory)
 {
 	defaultDir = defaultDirectory;
 }
@@ -204,20 +261,90 @@ bool QPathEdit::hasAcceptableInput() const
 	return wasPathValid;
 }
 
-bool QPathEdit::setPath(QString path, bool allowInvalid)
+QStringList QPathEdit::paths() const
+{
+	if(mode == ExistingFiles)
+		return PathChecker::splitPaths(currentValidPath, separator);
+	else if(currentValidPath.isEmpty())
+		return QStringList();
+	else
+		return QStringList(currentValidPath);
+}
+
+QStringList QPathEdit::editPaths() const
+{
+	if(mode == ExistingFiles)
+		return PathChecker::splitPaths(edit->text(), separator);
+	else if(edit->text().isEmpty())
+		return QStringList();
+	else
+		return QStringList(edit->text());
+}
+
+QVector<QPathEdit::ValidationState> QPathEdit::pathValidationStates() const
+{
+	if(mode == ExistingFiles)
+		return entryStates;
+	else if(edit->text().isEmpty())
+		return QVector<ValidationState>();
+	else
+		return QVector<ValidationState>(1, valState);
+}
+
+bool QPathEdit::setPaths(const QStringList &paths, bool allowInvalid)
+{
+	return setPath(joinPaths(paths), allowInvalid);
+}
+
+QSharedPointer<QPathFileSystemProvider> QPathEdit::fileSystemProvider() const
+{
+	return fsProvider ? fsProvider : QPathFileSystemProvider::local();
+}
+
+void QPathEdit::setFileSystemProvider(const QSharedPointer<QPathFileSystemProvider> &provider)
+{
+	//the default provider is not stored, so the local filesystem keeps the stat cache and the QFileSystemModel
+	QSharedPointer<QPathFileSystemProvider> newProvider;
+	if(provider != QPathFileSystemProvider::local())
+		newProvider = provider;
+	if(fsProvider == newProvider)
+		return;
+	fsProvider = newProvider;
+	pathValidator->setFileSystemProvider(fsProvider);
+	resetCompleter();
+	validateText(edit->text());
+	updatePathWatch();
+}
+
+bool QPathEdit::setPath(const QString &path, bool allowInvalid)
 {
 	if (edit->text() == path)
 		return true;
 
-	if(allowInvalid)
+	//even with asyncValidation, the path is checked right away, so invalid paths never end up in the edit
+	//the stat cache and its deadlines keep slow mounts from blocking this check
+	const QString newPath = NormalizedPath(path).toString();
+	const bool pathValid = pathValidator->validateState(path) == QPathValidation::Acceptable;
+	const ValidationState contentState = pathValid ? mimeState(newPath) : Invalid;
+	++setPathGeneration;
+	if(allowInvalid) {
 		edit->setText(path);
+		//the content is sniffed by the validation of the new text, and the path is committed afterwards
+		if(contentState == Pending) {
+			editTextUpdate();
+			return true;
+		}
+	} else if(contentState == Pending) {
+		//the content is never read in the GUI thread, so the path is only set once it is known to match
+		setPathWhenMatching(newPath);
+		return true;
+	}
 
-	int pseudo = 0;
-	if(pathValidator->validate(path, pseudo) == QValidator::Acceptable) {
-		currentValidPath = path.replace(QStringLiteral("\\"), QStringLiteral("/"));
+	if(contentState == Valid) {
+		currentValidPath = newPath;
 		if(!allowInvalid)
-			edit->setText(path);
-		emit pathChanged(path);
+			edit->setText(currentValidPath);
+		emit pathChanged(currentValidPath);
 		return true;
 	} else
 		return false;
@@ -235,33 +362,64 @@ QString QPathEdit::placeholder() const
 	return edit->placeholderText();
 }
 
-void QPathEdit::setPlaceholder(QString placeholder)
+void QPathEdit::setPlaceholder(const QString &placeholder)
 {
 	edit->setPlaceholderText(placeholder);
 }
 
 QStringList QPathEdit::nameFilters() const
 {
-	return dialog->nameFilters();
+	return nameFilterList;
 }
 
-void QPathEdit::setNameFilters(QStringList nameFilters)
+void QPathEdit::setNameFilters(const QStringList &nameFilters)
 {
-	dialog->setNameFilters(nameFilters);
-	QStringList tmp = modelFilters(nameFilters);
-	completerModel->setNameFilters(tmp);
+	nameFilterList = nameFilters;
+	const bool hadMimeChecks = mimeChecksActive();
+	mimeFiltersActive = false;
+	if(dialog)
+		dialog->setNameFilters(nameFilters);
+	updateFilterMatcher();
+	if(hadMimeChecks) {
+		resetMimeChecks();
+		validateText(edit->text());
+	}
 }
 
 QStringList QPathEdit::mimeTypeFilters() const
 {
-	return dialog->mimeTypeFilters();
+	return mimeFilterList;
 }
 
-void QPathEdit::setMimeTypeFilters(QStringList mimeFilters)
+void QPathEdit::setMimeTypeFilters(const QStringList &mimeFilters)
 {
-	dialog->setMimeTypeFilters(mimeFilters);
-	QStringList tmp = modelFilters(dialog->nameFilters());
-	completerModel->setNameFilters(tmp);
+	mimeFilterList = mimeFilters;
+	mimeFiltersActive = true;
+
+	//same conversion as done by QFileDialog::setMimeTypeFilters
+	QMimeDatabase mimeDb;
+	nameFilterList.clear();
+	foreach(const QString &mimeName, mimeFilters) {
+		QMimeType mime = mimeDb.mimeTypeForName(mimeName);
+		if(!mime.isValid())
+			continue;
+		if(mime.isDefault())
+			nameFilterList.append(QFileDialog::tr("All files (*)"));
+		else {
+			nameFilterList.append(mime.comment() +
+								  QStringLiteral(" (") +
+								  mime.globPatterns().join(QLatin1Char(' ')) +
+								  QLatin1Char(')'));
+		}
+	}
+
+	if(dialog)
+		dialog->setMimeTypeFilters(mimeFilters);
+	updateFilterMatcher();
+	if(validateMimes) {
+		resetMimeChecks();
+		validateText(edit->text());
+	}
 }
 
 bool QPathEdit::isEditable() const
@@ -276,12 +434,14 @@ void QPathEdit::setEditable(bool editable)
 
 bool QPathEdit::useCompleter() const
 {
-	return edit->completer();
+	return completerEnabled;
 }
 
 void QPathEdit::setUseCompleter(bool useCompleter)
 {
-	edit->setCompleter(useCompleter ? pathCompleter : nullptr);
+	completerEnabled = useCompleter;
+	if(pathCompleter)
+		edit->setCompleter(useCompleter ? pathCompleter : nullptr);
 }
 
 QPathEdit::Style QPathEdit::style() const
@@ -297,15 +457,20 @@ void QPathEdit::setStyle(QPathEdit::Style style, QLineEdit::ActionPosition posit
 	switch(style) {
 	case SeperatedButton:
 		edit->removeAction(dialogAction);
-		toolButton->setVisible(true);
+		if(toolButton)
+			toolButton->setVisible(true);
+		else
+			initToolButton();
 		break;
 	case JoinedButton:
 		edit->addAction(dialogAction, position);
-		toolButton->setVisible(false);
+		if(toolButton)
+			toolButton->setVisible(false);
 		break;
 	case NoButton:
 		edit->removeAction(dialogAction);
-		toolButton->setVisible(false);
+		if(toolButton)
+			toolButton->setVisible(false);
 		break;
 	default:
 		Q_UNREACHABLE();
@@ -334,59 +499,305 @@ void QPathEdit::resetDialogButtonIcon()
 	hasCustomIcon = false;
 }
 
+QPathEdit::CompleterBackend QPathEdit::completerBackend() const
+{
+	return completerBackendType;
+}
+
+void QPathEdit::setCompleterBackend(QPathEdit::CompleterBackend completerBackend)
+{
+	if(completerBackendType == completerBackend)
+		return;
+	completerBackendType = completerBackend;
+	resetCompleter();
+}
+
+QPathEdit::CompletionMode QPathEdit::completionMode() const
+{
+	return completionModeType;
+}
+
+void QPathEdit::setCompletionMode(QPathEdit::CompletionMode completionMode)
+{
+	if(completionModeType == completionMode)
+		return;
+	completionModeType = completionMode;
+	resetCompleter();
+}
+
+QPathEdit::CompleterIcons QPathEdit::completerIcons() const
+{
+	return iconMode;
+}
+
+void QPathEdit::setCompleterIcons(QPathEdit::CompleterIcons completerIcons)
+{
+	const bool modelChanged = (iconMode == FileIcons) != (completerIcons == FileIcons);
+	iconMode = completerIcons;
+	//the file system backend only loads real icons with FileIcons, which needs another shared model
+	if(completerModel && modelChanged)
+		resetCompleter();
+	else if(completerModel)
+		completerModel->setIconMode(iconMode);
+	if(listModel)
+		listModel->setIconMode(iconMode);
+}
+
+int QPathEdit::fuzzyCompletionLimit() const
+{
+	return fuzzyLimit;
+}
+
+void QPathEdit::setFuzzyCompletionLimit(int fuzzyCompletionLimit)
+{
+	fuzzyLimit = qMax(fuzzyCompletionLimit, 0);
+	if(listModel)
+		listModel->setFuzzyCompletion(completionModeType == FuzzyCompletion, fuzzyLimit);
+}
+
+QChar QPathEdit::pathSeparator() const
+{
+	return separator;
+}
+
+void QPathEdit::setPathSeparator(QChar pathSeparator)
+{
+	if(separator == pathSeparator)
+		return;
+	separator = pathSeparator;
+	pathValidator->setSeparator(pathSeparator);
+	if(mode == ExistingFiles)
+		validateText(edit->text());
+}
+
+bool QPathEdit::watchPath() const
+{
+	return watchEnabled;
+}
+
+void QPathEdit::setWatchPath(bool watchPath)
+{
+	if(watchEnabled == watchPath)
+		return;
+	watchEnabled = watchPath;
+	if(watchEnabled && !watchTimer) {
+		//bursts of changes, like a file beeing written, are checked only once
+		watchTimer = new QTimer(this);
+		watchTimer->setSingleShot(true);
+		watchTimer->setInterval(50);
+		connect(watchTimer, &QTimer::timeout, this, &QPathEdit::checkWatchedPaths);
+	}
+	updatePathWatch();
+}
+
+int QPathEdit::completionDelay() const
+{
+	return completionInterval;
+}
+
+void QPathEdit::setCompletionDelay(int completionDelay)
+{
+	completionInterval = qMax(completionDelay, 0);
+	if(completionTimer)
+		completionTimer->setInterval(completionInterval);
+}
+
+int QPathEdit::completionPrefetch() const
+{
+	return prefetchCount;
+}
+
+void QPathEdit::setCompletionPrefetch(int completionPrefetch)
+{
+	//the listing cache only holds 16 directories, so more would evict the ones in use
+	const int count = qBound(0, completionPrefetch, 8);
+	const bool backendChanged = (prefetchCount > 0) != (count > 0);
+	prefetchCount = count;
+	if(backendChanged)
+		resetCompleter();
+	else if(listModel)
+		listModel->setPrefetchCount(prefetchCount);
+}
+
+bool QPathEdit::validateNameFilters() const
+{
+	return validateFilters;
+}
+
+void QPathEdit::setValidateNameFilters(bool validateNameFilters)
+{
+	validateFilters = validateNameFilters;
+	pathValidator->setFilterMatcher(validateFilters ? filterMatcher : NameFilterMatcherPtr());
+	validateText(edit->text());
+}
+
+bool QPathEdit::validateMimeTypes() const
+{
+	return validateMimes;
+}
+
+void QPathEdit::setValidateMimeTypes(bool validateMimeTypes)
+{
+	if(validateMimes == validateMimeTypes)
+		return;
+	validateMimes = validateMimeTypes;
+	resetMimeChecks();
+	validateText(edit->text());
+}
+
+bool QPathEdit::asyncValidation() const
+{
+	return asyncValidate;
+}
+
+void QPathEdit::setAsyncValidation(bool asyncValidation)
+{
+	if(asyncValidate == asyncValidation)
+		return;
+
+	asyncValidate = asyncValidation;
+	//without a validator, the line edit does not block input while the result is unknown
+	if(asyncValidate)
+		edit->setValidator(nullptr);
+	else {
+		pathValidator->cancelAsync();
+		commitPending = false;
+		edit->setValidator(pathValidator);
+	}
+	validateText(edit->text());
+}
+
+QPathEdit::ValidationState QPathEdit::validationState() const
+{
+	return valState;
+}
+
+int QPathEdit::statCacheTimeout()
+{
+	return PathStatCache::instance()->timeout();
+}
+
+void QPathEdit::setStatCacheTimeout(int msecs)
+{
+	PathStatCache::instance()->setTimeout(msecs);
+}
+
+int QPathEdit::statCacheSize()
+{
+	return PathStatCache::instance()->maxSize();
+}
+
+void QPathEdit::setStatCacheSize(int size)
+{
+	PathStatCache::instance()->setMaxSize(size);
+}
+
+QPathEditStatistics QPathEdit::statistics() const
+{
+	return perfCounters ? perfCounters->snapshot() : QPathEditStatistics();
+}
+
+void QPathEdit::resetStatistics()
+{
+	if(perfCounters)
+		perfCounters->reset();
+}
+
+QPathEditStatistics QPathEdit::globalStatistics()
+{
+	return PerformanceCounters::global()->snapshot();
+}
+
+void QPathEdit::resetGlobalStatistics()
+{
+	PerformanceCounters::global()->reset();
+}
+
 void QPathEdit::showDialog()
 {
-	if(dialog->isVisible()) {
+	QElapsedTimer openTimer;
+	openTimer.start();
+	if(dialog) {
 		dialog->raise();
 		dialog->activateWindow();
 		return;
 	}
+	initDialog();
 
 	QString oldPath = edit->text();
-	if(oldPath.isEmpty())
+	if(mode == ExistingFiles) {
+		//the dialog can only start in one directory, so the one of the first path is used
+		QStringList oldPaths = PathChecker::splitPaths(oldPath, separator);
+		oldPath = oldPaths.isEmpty() ? QString() : oldPaths.first();
+	}
+	//the dialog only knows the local filesystem
+	if(oldPath.isEmpty() || fsProvider)
 		dialog->setDirectory(defaultDir);
 	else {
-		if(mode == ExistingFolder)
+		//a directory on a hung mount would freeze the dialog, so the default one is used instead
+		PathStat pathStat = PathStatCache::instance()->stat(oldPath, localCounters().data());
+		if(!pathStat.verified)
+			dialog->setDirectory(defaultDir);
+		else if(mode == ExistingFolder || pathStat.isDir)
 			dialog->setDirectory(oldPath);
 		else {
 			QFileInfo info(oldPath);
-			if(info.isDir())
-				dialog->setDirectory(oldPath);
-			else {
-				dialog->setDirectory(info.dir());
-				dialog->selectFile(info.fileName());
-			}
+			dialog->setDirectory(info.dir());
+			dialog->selectFile(info.fileName());
+			dialogFileSelected = true;
 		}
 	}
 
 	dialog->open();
+	PerformanceCounters::count(localCounters().data(), QPathEditStatistics::DialogOpens);
+	PerformanceCounters::time(localCounters().data(), QPathEditStatistics::DialogOpenTime, openTimer.nsecsElapsed());
+	qCDebug(qpatheditPerformance) << "Opened file dialog in" << openTimer.nsecsElapsed() / 1000 << "us";
 }
 
 void QPathEdit::updateValidInfo(const QString &path)
 {
 	emit editPathChanged(path);
-	completerModel->index(QFileInfo(path).dir().absolutePath());//enforce "directory loading"
-	if(edit->hasAcceptableInput()) {
-		if(!wasPathValid) {
-			wasPathValid = true;
-			edit->setPalette(palette());
-			emit acceptableInputChanged(wasPathValid);
-		}
-	} else {
-		if(wasPathValid) {
-			wasPathValid = false;
-			QPalette pal = palette();
-			pal.setColor(QPalette::Text, QColor(QStringLiteral("#B40404")));
-			edit->setPalette(pal);
-			emit acceptableInputChanged(wasPathValid);
-		}
+	if(completerEnabled && (completerModel || listModel)) {
+		//coalesce fast typing and pasting into a single directory load
+		if(completionInterval > 0) {
+			if(!completionTimer) {
+				completionTimer = new QTimer(this);
+				completionTimer->setSingleShot(true);
+				completionTimer->setInterval(completionInterval);
+				connect(completionTimer, &QTimer::timeout, this, &QPathEdit::loadCompletionDirectory);
+			}
+			completionTimer->start();
+		} else
+			loadCompletionDirectory();
 	}
+	validateText(path);
+}
+
+void QPathEdit::validateText(const QString &path)
+{
+	localCounters();
+	if(asyncValidate) {
+		commitPending = false;
+		setValidationState(Pending);
+		if(mode == ExistingFiles)
+			entryStates.fill(Pending, PathChecker::splitPaths(path, separator).size());
+		pathValidator->validateAsync(path);
+	} else if(mode == ExistingFiles)
+		finishValidation(path, pathValidator->validateEntries(path));
+	else
+		finishValidation(path, pathValidator->validateState(path));
 }
 
 void QPathEdit::editTextUpdate()
 {
-	if(edit->hasAcceptableInput()) {
-		QString newPath = edit->text().replace(QStringLiteral("\\"), QStringLiteral("/"));
+	if(valState == Pending) {
+		commitPending = true;//commit as soon as the result is known
+		return;
+	}
+
+	if((asyncValidate || mimeChecksActive()) ? valState == Valid : edit->hasAcceptableInput()) {
+		//shares the text of the edit unless it contains backslashes
+		QString newPath = NormalizedPath(edit->text()).toString();
 		if(currentValidPath != newPath) {
 			currentValidPath = newPath;
 			emit pathChanged(currentValidPath);
@@ -394,163 +805,1897 @@ void QPathEdit::editTextUpdate()
 	}
 }
 
-void QPathEdit::dialogFileSelected(const QString &file)
+void QPathEdit::dialogFilesSelected(const QStringList &files)
 {
-	if(!file.isEmpty()) {
-		edit->setText(dialog->selectedFiles()
-							.first()
-							.replace(QStringLiteral("\\"), QStringLiteral("/")));
-		editTextUpdate();
-	}
+	if(files.isEmpty())
+		return;
+
+	QStringList paths;
+	paths.reserve(files.size());
+	foreach(const QString &file, files)
+		paths.append(NormalizedPath(file).toString());
+	edit->setText(mode == ExistingFiles ? joinPaths(paths) : paths.first());
+	editTextUpdate();
 }
 
-QStringList QPathEdit::modelFilters(const QStringList &normalFilters)
+void QPathEdit::initCompleter()
 {
-	QStringList res;
-	foreach(QString filter, normalFilters) {
-		QRegularExpressionMatch match = QRegularExpression(QStringLiteral("^.*\\((.*)\\)$"))
-										.match(filter);
-		if(match.hasMatch())
-			res.append(match.captured(1).split(QRegularExpression(QStringLiteral("\\s"))));
+	//a disabled completer is never built, so it loads no directories either
+	if(pathCompleter || !completerEnabled)
+		return;
+
+	//fuzzy completion ranks the entries itself, which only the list model can do
+	//multiple paths are completed one after another, which the file system model cannot do
+	//other filesystem providers and prefetching are only supported by the list model too
+	CompleterBackend backend = completerBackendType;
+	if(completionModeType == FuzzyCompletion || mode == ExistingFiles || fsProvider || prefetchCount > 0)
+		backend = DirectoryListBackend;
+
+	switch(backend) {
+	case FileSystemBackend:
+		completerModel = new CompleterFilterModel(iconMode, this);
+		pathCompleter = new PathCompleter(this);
+		connect(completerModel->fileSystemModel(), &QFileSystemModel::directoryLoaded,
+				this, &QPathEdit::completionDirectoryLoaded);
+		pathCompleter->setModel(completerModel);
+		break;
+	case DirectoryListBackend:
+		listModel = new DirectoryListModel(fsProvider, this);
+		listModel->setPrefetchCount(prefetchCount);
+		listModel->setIconMode(iconMode);
+		pathCompleter = new QCompleter(this);
+		connect(listModel, &DirectoryListModel::directoryLoaded,
+				this, &QPathEdit::completionDirectoryLoaded);
+		pathCompleter->setModel(listModel);
+		if(completionModeType == FuzzyCompletion) {
+			listModel->setFuzzyCompletion(true, fuzzyLimit);
+			pathCompleter->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+		} else {
+			//the entries are sorted by name, and all of them share the same prefix
+			pathCompleter->setModelSorting(QCompleter::CaseSensitivelySortedModel);
+		}
+		break;
+	default:
+		Q_UNREACHABLE();
 	}
-	return res;
+	updateCompleterFilters();
+
+	//all rows have the same height, so the popup does not measure millions of them
+	if(QListView *popup = qobject_cast<QListView*>(pathCompleter->popup()))
+		popup->setUniformItemSizes(true);
+
+	edit->setCompleter(pathCompleter);
+	loadCompletionDirectory();
 }
 
-QIcon QPathEdit::getDefaultIcon()
+void QPathEdit::loadCompletionDirectory()
 {
-	switch(uiStyle) {
-	case SeperatedButton:
-	{
-		QImage image(16, 16, QImage::Format_ARGB32);
-		image.fill(Qt::transparent);
-		QPainter painter(&image);
-		painter.setFont(font());
-		painter.setPen(palette().color(QPalette::ButtonText));
-		painter.drawText(QRect(0, 0, 16, 16), Qt::AlignCenter, tr("…"));
-		return QPixmap::fromImage(image);
+	if(completionTimer)
+		completionTimer->stop();
+	QString text = edit->text();
+	int entryStart = 0;
+	QString dirPath = QFileInfo(completionEntry(&entryStart)).dir().absolutePath();
+	if(dirPath != completionDir) {
+		PerformanceCounters::count(localCounters().data(), QPathEditStatistics::DirectoryLoads);
+		loadTimer.start();
 	}
-	case JoinedButton:
-		return QIcon::fromTheme(QStringLiteral("view-choose"), QIcon(QStringLiteral(":/qpathedit/icons/dialog.ico")));
-	case NoButton:
-		return QIcon();
-	default:
-		Q_UNREACHABLE();
+	if(listModel) {
+		//the list model completes the text as typed, so it needs the typed prefix too
+		int sepIndex = qMax(text.lastIndexOf(QLatin1Char('/')), text.lastIndexOf(QLatin1Char('\\')));
+		sepIndex = qMax(sepIndex, entryStart - 1);
+		listModel->setDirectory(dirPath, text.left(sepIndex + 1));
+		completionDir = dirPath;
+		if(completionModeType == FuzzyCompletion) {
+			listModel->setFuzzyPattern(text.mid(sepIndex + 1));
+			if(listModel->hasListing())
+				completionDirectoryLoaded(dirPath);
+		} else
+			listModel->setNamePrefix(text.mid(sepIndex + 1));
+		return;
 	}
+
+	if(dirPath == completionDir)
+		return;
+	completionDir = dirPath;
+	completerModel->fileSystemModel()->index(dirPath);//enforce "directory loading"
 }
 
-bool QPathEdit::eventFilter(QObject *watched, QEvent *event)
+void QPathEdit::resetCompleter()
 {
-	if (event->type() == QEvent::KeyPress) {
-		QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
-		if(keyEvent->key() == Qt::Key_Space &&
-				keyEvent->modifiers() == Qt::ControlModifier){
-			pathCompleter->complete();
-			return true;
-		} else
-			return QObject::eventFilter(watched, event);
-	} else if (event->type() == QEvent::Drop) {
-		QDropEvent *dropEvent = static_cast<QDropEvent*>(event);
-		if (dropEvent->mimeData()->hasUrls()
-			&& dropEvent->mimeData()->urls().count() == 1
-			&& dropEvent->mimeData()->urls().first().isLocalFile()) {
-			
-			QString filePath = dropEvent->mimeData()->urls().first().toLocalFile();
-			bool matched = true;
-
-			QFileInfo fi(filePath);
-			if (!dialog->nameFilters().isEmpty() && fi.isFile() && mode == ExistingFile) {
-				const QString fileNameSuffix = fi.suffix();
-				if (!fileNameSuffix.isEmpty()) {
-					// regexp copied from Qt sources QPlatformFileDialogHelper::filterRegExp
-					QRegularExpression regexp("^(.*)\\(([a-zA-Z0-9_.,*? +;#\\-\\[\\]@\\{\\}/!<>\\$%&=^~:\\|]*)\\)$");
-
-					// Makes a ["*.png", "*.jpg", "*.bmp"] formatted list of filters
-					// from the extension filters in format ["Image Files (*.png *.jpg)", ""Bitmaps (*.bmp)]
-					QStringList extensionsFilters;
-					foreach (const QString & filter, dialog->nameFilters()) {
-						QString f = filter;
-						QRegularExpressionMatch match;
-						filter.indexOf(regexp, 0, &match);
-						if (match.hasMatch())
-							f = match.captured(2);
-						extensionsFilters.append(f.split(QLatin1Char(' '), QString::SkipEmptyParts));
-					}
-
-					matched = false;
-					foreach (const QString & extensionFilter, extensionsFilters) {
-						if (extensionFilter == QStringLiteral("*.*")) {
-							matched = true;
-							break;
-						}
-
-						const QString filterSuffix = QFileInfo(extensionFilter).suffix();
-						if (!filterSuffix.isEmpty()) {
-							if (fileNameSuffix == filterSuffix) {
-								matched = true;
-								break;
-							}
-						}
-					}
-				}
-			}
+	//recreate an already existing completer with the new settings
+	if(pathCompleter) {
+		edit->setCompleter(nullptr);
+		delete pathCompleter;
+		pathCompleter = nullptr;
+		delete completerModel;
+		completerModel = nullptr;
+		delete listModel;
+		listModel = nullptr;
+		completionDir.clear();
+		initCompleter();
+	}
+}
 
-			if (matched)
-				setPath(filePath);
-			return true;
-		}
-		return false;
-	} else
-		return QObject::eventFilter(watched, event);
+void QPathEdit::updateCompleterFilters()
+{
+	if(completerModel) {
+		completerModel->setMode(mode);
+		completerModel->setFilterMatcher(filterMatcher);
+	}
+	if(listModel) {
+		listModel->setMode(mode);
+		listModel->setFilterMatcher(filterMatcher);
+	}
 }
 
-//HELPER CLASSES IMPLEMENTATION
+void QPathEdit::updateFilterMatcher()
+{
+	//compiled once, and then shared by the completer, the validator and drag and drop
+	filterMatcher.reset(new NameFilterMatcher(nameFilterList));
+	updateCompleterFilters();
+	if(validateFilters) {
+		pathValidator->setFilterMatcher(filterMatcher);
+		validateText(edit->text());
+	}
+}
 
-PathValidator::PathValidator(QObject *parent) :
-	QValidator(parent),
-	mode(QPathEdit::ExistingFile),
-	allowEmpty(true)
-{}
+void QPathEdit::completionDirectoryLoaded(const QString &dirPath)
+{
+	//the model is shared, so only the edit beeing typed in may complete, and only if the user did not move on
+	if(!edit->hasFocus())
+		return;
+	if(QDir::cleanPath(QDir::fromNativeSeparators(dirPath)) != QFileInfo(completionEntry()).dir().absolutePath())
+		return;
 
-void PathValidator::setMode(QPathEdit::PathMode mode)
+	if(loadTimer.isValid()) {
+		PerformanceCounters::time(localCounters().data(), QPathEditStatistics::DirectoryLoadTime, loadTimer.nsecsElapsed());
+		qCDebug(qpatheditPerformance) << "Loaded directory" << dirPath << "in" << loadTimer.nsecsElapsed() / 1000 << "us";
+		loadTimer.invalidate();
+	}
+	showCompletion();
+}
+
+void QPathEdit::showCompletion()
 {
-	this->mode = mode;
+	QElapsedTimer completeTimer;
+	completeTimer.start();
+	pathCompleter->complete();
+	PerformanceCounters::count(localCounters().data(), QPathEditStatistics::Completions);
+	PerformanceCounters::time(localCounters().data(), QPathEditStatistics::CompletionTime, completeTimer.nsecsElapsed());
 }
 
-void PathValidator::setAllowEmpty(bool allow)
+void QPathEdit::initDialog()
 {
-	allowEmpty = allow;
+	//the dialog is borrowed from the pool while it is open, so all settings of the previous user are replaced
+	dialog = FileDialogPool::checkOut(this);
+	dialog->setOptions(dlgOptions);
+	updateDialogMode();
+	if(mimeFiltersActive)
+		dialog->setMimeTypeFilters(mimeFilterList);
+	else
+		dialog->setNameFilters(nameFilterList);
+	//the filter the previous user picked might exist in this list as well
+	const QStringList dialogFilters = dialog->nameFilters();
+	if(!dialogFilters.isEmpty())
+		dialog->selectNameFilter(dialogFilters.first());
+	connect(dialog, &QFileDialog::filesSelected, this, &QPathEdit::dialogFilesSelected);
+	connect(dialog, &QFileDialog::finished, this, &QPathEdit::dialogFinished);
 }
 
-QValidator::State PathValidator::validate(QString &text, int &) const
+void QPathEdit::dialogFinished()
 {
-	//check if empty is accepted
-	if(text.isEmpty())
-		return allowEmpty ? QValidator::Acceptable : QValidator::Intermediate;
+	releaseDialog();
+}
 
-	//nonexisting parent dir is not possible
-	QFileInfo pathInfo(text);
-	if(!pathInfo.dir().exists())
-		return QValidator::Invalid;
+void QPathEdit::releaseDialog()
+{
+	if(!dialog)
+		return;
+	dialog->disconnect(this);
+	FileDialogPool::checkIn(dialog, dialogFileSelected);
+	dialog = nullptr;
+	dialogFileSelected = false;
+}
 
-	switch(mode) {
-	case QPathEdit::AnyFile://acceptable, as long as it's not an directoy
-		if(pathInfo.isDir())
-			return QValidator::Intermediate;
-		else
-			return QValidator::Acceptable;
-	case QPathEdit::ExistingFile://must be an existing file
-		if(pathInfo.exists() && pathInfo.isFile())
-			return QValidator::Acceptable;
-		else
-			return QValidator::Intermediate;
-	case QPathEdit::ExistingFolder://must be an existing folder
-		if(pathInfo.exists() && pathInfo.isDir())
-			return QValidator::Acceptable;
+void QPathEdit::initToolButton()
+{
+	toolButton = new QToolButton(this);
+	toolButton->setDefaultAction(dialogAction);
+	int height = edit->sizeHint().height();
+#ifdef Q_OS_WIN
+	height += 2;
+#endif
+	toolButton->setFixedSize(height, height);
+	layout()->addWidget(toolButton);
+	QWidget::setTabOrder(edit, toolButton);
+}
+
+void QPathEdit::asyncValidated(const QString &path, QPathValidation::State, const QVector<QPathValidation::State> &states)
+{
+	if(!asyncValidate || path != edit->text())
+		return;
+	finishValidation(path, states);
+}
+
+void QPathEdit::updatePathWatch()
+{
+	if(watchProvider) {
+		foreach(const QString &dirPath, watchedDirs)
+			watchProvider->unwatch(dirPath);
+		disconnect(watchConnection);
+		watchProvider.reset();
+	}
+	watchedPaths.clear();
+	watchedTypes.clear();
+	watchedDirs.clear();
+	if(!watchEnabled || currentValidPath.isEmpty())
+		return;
+
+	//the parent directories are watched, as only they report entries beeing removed or created.
+	//The provider shares its watches with all other edits, so each directory is only watched once
+	watchProvider = fileSystemProvider();
+	watchedPaths = paths();
+	foreach(const QString &path, watchedPaths) {
+		watchedTypes.append(watchProvider->entryType(path));
+		//the directory is taken from the text only, as the path may not be on the local filesystem.
+		//Relative paths are relative to the working directory, or to the root of other providers
+		QString dirPath = QDir::cleanPath(NormalizedPath(path).directoryPrefix().toString());
+		if(dirPath.isEmpty())
+			dirPath = QStringLiteral(".");
+		if(!NormalizedPath::isAbsolute(dirPath)) {
+			dirPath = fsProvider ?
+						  QDir::cleanPath(QLatin1Char('/') + dirPath) :
+						  QDir::cleanPath(QDir::current().absoluteFilePath(dirPath));
+		}
+		if(!watchedDirs.contains(dirPath)) {
+			watchedDirs.append(dirPath);
+			watchProvider->watch(dirPath);
+		}
+	}
+	watchConnection = connect(watchProvider.data(), &QPathFileSystemProvider::directoryChanged,
+							  this, [this](const QString &dirPath){
+		if(watchedDirs.contains(dirPath))
+			watchTimer->start();
+	});
+}
+
+void QPathEdit::checkWatchedPaths()
+{
+	if(!watchProvider)
+		return;
+
+	QStringList changedPaths;
+	for(int i = 0; i < watchedPaths.size(); ++i) {
+		QPathFileSystemProvider::EntryType type = watchProvider->entryType(watchedPaths[i]);
+		//a filesystem that does not respond in time is no reason to report a change
+		if(type == QPathFileSystemProvider::Unknown || type == watchedTypes[i])
+			continue;
+		watchedTypes[i] = type;
+		changedPaths.append(watchedPaths[i]);
+	}
+	if(changedPaths.isEmpty())
+		return;
+
+	//the signals are emitted last, as their receivers might set a new path
+	resetMimeChecks();
+	validateText(edit->text());
+	foreach(const QString &path, changedPaths)
+		emit watchedPathChanged(path);
+}
+
+void QPathEdit::finishValidation(const QString &text, QPathValidation::State state)
+{
+	//content checks need the list form, all other single paths are finished without allocating
+	if(mimeChecksActive()) {
+		finishValidation(text, QVector<QPathValidation::State>(1, state));
+		return;
+	}
+
+	setValidationState(toValidationState(state));
+	if(commitPending) {
+		commitPending = false;
+		editTextUpdate();
+	}
+}
+
+void QPathEdit::finishValidation(const QString &text, QVector<QPathValidation::State> states)
+{
+	//the contents are only sniffed for files that passed all other checks, and never in the GUI thread
+	if(mimeChecksActive()) {
+		const QStringList paths = mode == ExistingFiles ? PathChecker::splitPaths(text, separator) : QStringList(text);
+		bool unchecked = false;
+		for(int i = 0; i < states.size() && i < paths.size(); ++i) {
+			if(states[i] != QPathValidation::Acceptable || paths[i].isEmpty())
+				continue;
+			auto it = mimeVerdicts.constFind(paths[i]);
+			if(it == mimeVerdicts.constEnd())
+				unchecked = true;
+			else if(!it.value())
+				states[i] = QPathValidation::Invalid;
+		}
+		if(unchecked) {
+			setValidationState(Pending);
+			if(mode == ExistingFiles)
+				entryStates.fill(Pending, states.size());
+			checkMimeTypes(text, paths, states);
+			return;
+		}
+	}
+
+	setValidationState(toValidationState(pathValidator->combineStates(states)));
+	if(mode == ExistingFiles)
+		setEntryStates(states);
+	if(commitPending) {
+		commitPending = false;
+		editTextUpdate();
+	}
+}
+
+bool QPathEdit::mimeChecksActive() const
+{
+	//only local files can be read, and only files that must exist have a content
+	return validateMimes && mimeFiltersActive && !mimeFilterList.isEmpty() && !fsProvider &&
+			(mode == ExistingFile || mode == ExistingFiles);
+}
+
+QPathEdit::ValidationState QPathEdit::mimeState(const QString &text) const
+{
+	if(!mimeChecksActive())
+		return Valid;
+
+	//only answers from the verdicts that are already known, files are never read here
+	ValidationState state = Valid;
+	const QStringList paths = mode == ExistingFiles ? PathChecker::splitPaths(text, separator) : QStringList(text);
+	foreach(const QString &path, paths) {
+		if(path.isEmpty())
+			continue;
+		auto it = mimeVerdicts.constFind(path);
+		if(it == mimeVerdicts.constEnd())
+			state = Pending;
+		else if(!it.value())
+			return Invalid;
+	}
+	return state;
+}
+
+void QPathEdit::setPathWhenMatching(const QString &path)
+{
+	const int generation = setPathGeneration;
+	const QString oldText = edit->text();
+	const QStringList paths = mode == ExistingFiles ? PathChecker::splitPaths(path, separator) : QStringList(path);
+	const QStringList filters = mimeFilterList;
+
+	typedef QHash<QString, bool> VerdictHash;
+	QFutureWatcher<VerdictHash> *watcher = new QFutureWatcher<VerdictHash>(this);
+	connect(watcher, &QFutureWatcher<VerdictHash>::finished, this, [this, watcher, path, oldText, generation](){
+		watcher->deleteLater();
+		//a newer path, typed text or other filters replace this one
+		if(setPathGeneration != generation || edit->text() != oldText || !mimeChecksActive())
+			return;
+		const VerdictHash verdicts = watcher->result();
+		for(auto it = verdicts.constBegin(); it != verdicts.constEnd(); ++it)
+			mimeVerdicts.insert(it.key(), it.value());
+		//the verdicts are kept, so the validation of the new text does not sniff the files again
+		if(mimeState(path) == Valid) {
+			edit->setText(path);
+			editTextUpdate();
+		}
+	});
+	watcher->setFuture(QtConcurrent::run(PathChecker::threadPool(), [paths, filters](){
+		VerdictHash verdicts;
+		foreach(const QString &file, paths) {
+			if(!file.isEmpty())
+				verdicts.insert(file, MimeTypeCache::instance()->matches(file, filters));
+		}
+		return verdicts;
+	}));
+}
+
+void QPathEdit::checkMimeTypes(const QString &text, const QStringList &paths, const QVector<QPathValidation::State> &states)
+{
+	const int generation = ++mimeGeneration;
+	//only the verdicts of the current paths are kept, so the memo never grows
+	QSet<QString> currentPaths = paths.toSet();
+	for(auto it = mimeVerdicts.begin(); it != mimeVerdicts.end();) {
+		if(currentPaths.contains(it.key()))
+			++it;
 		else
-			return QValidator::Intermediate;
+			it = mimeVerdicts.erase(it);
+	}
+
+	QStringList unchecked;
+	for(int i = 0; i < states.size() && i < paths.size(); ++i) {
+		if(states[i] == QPathValidation::Acceptable && !paths[i].isEmpty() && !mimeVerdicts.contains(paths[i]))
+			unchecked.append(paths[i]);
+	}
+	const QStringList filters = mimeFilterList;
+
+	typedef QHash<QString, bool> VerdictHash;
+	QFutureWatcher<VerdictHash> *watcher = new QFutureWatcher<VerdictHash>(this);
+	connect(watcher, &QFutureWatcher<VerdictHash>::finished, this, [this, watcher, text, states, generation](){
+		watcher->deleteLater();
+		//newer text or other filters might have made this check obsolete
+		if(mimeGeneration != generation || edit->text() != text)
+			return;
+		const VerdictHash verdicts = watcher->result();
+		for(auto it = verdicts.constBegin(); it != verdicts.constEnd(); ++it)
+			mimeVerdicts.insert(it.key(), it.value());
+		finishValidation(text, states);
+	});
+	//files that were already sniffed with the same inode and modification time are answered from the cache
+	watcher->setFuture(QtConcurrent::run(PathChecker::threadPool(), [unchecked, filters](){
+		VerdictHash verdicts;
+		foreach(const QString &path, unchecked)
+			verdicts.insert(path, MimeTypeCache::instance()->matches(path, filters));
+		return verdicts;
+	}));
+}
+
+void QPathEdit::resetMimeChecks()
+{
+	mimeVerdicts.clear();
+	++mimeGeneration;
+}
+
+void QPathEdit::setValidationState(QPathEdit::ValidationState state)
+{
+	if(valState == state)
+		return;
+	valState = state;
+
+	//while pending, the previous acceptable state is kept to avoid flickering
+	if(state == Valid) {
+		edit->setPalette(palette());
+		if(!wasPathValid) {
+			wasPathValid = true;
+			emit acceptableInputChanged(wasPathValid);
+		}
+	} else if(state == Invalid || state == Unverified) {
+		QPalette pal = palette();
+		pal.setColor(QPalette::Text, QColor(state == Invalid ? QStringLiteral("#B40404") : QStringLiteral("#B45F04")));
+		edit->setPalette(pal);
+		if(wasPathValid) {
+			wasPathValid = false;
+			emit acceptableInputChanged(wasPathValid);
+		}
+	}
+
+	emit validationStateChanged(state);
+}
+
+void QPathEdit::setEntryStates(const QVector<QPathValidation::State> &states)
+{
+	entryStates.resize(states.size());
+	for(int i = 0; i < states.size(); ++i)
+		entryStates[i] = toValidationState(states[i]);
+	emit pathsValidated(entryStates);
+}
+
+QString QPathEdit::joinPaths(const QStringList &paths) const
+{
+	return paths.join(QString(separator) + QLatin1Char(' '));
+}
+
+QString QPathEdit::completionEntry(int *entryStart) const
+{
+	//only the last of multiple paths is completed, all others are kept as they are
+	QString text = edit->text();
+	int start = 0;
+	if(mode == ExistingFiles) {
+		start = text.lastIndexOf(separator) + 1;
+		while(start < text.size() && text[start].isSpace())
+			++start;
+	}
+	if(entryStart)
+		*entryStart = start;
+	return text.mid(start);
+}
+
+QIcon QPathEdit::getDefaultIcon()
+{
+	if(uiStyle == NoButton)
+		return QIcon();
+
+	//edits that look the same share one icon, so it is only rendered once per process
+	QHash<DefaultIconKey, QIcon> &iconCache = defaultIconCache();
+	DefaultIconKey key;
+	key.style = uiStyle;
+	key.color = 0;
+	key.devicePixelRatio = 1.0;
+	if(uiStyle == SeperatedButton) {
+		key.text = tr("…");
+		key.font = font().key();
+		key.color = palette().color(QPalette::ButtonText).rgba();
+		key.devicePixelRatio = devicePixelRatioF();
+	}
+	auto it = iconCache.constFind(key);
+	if(it != iconCache.constEnd())
+		return it.value();
+
+	QIcon icon;
+	switch(uiStyle) {
+	case SeperatedButton:
+	{
+		QImage image(QSize(16, 16) * key.devicePixelRatio, QImage::Format_ARGB32);
+		image.setDevicePixelRatio(key.devicePixelRatio);
+		image.fill(Qt::transparent);
+		QPainter painter(&image);
+		painter.setFont(font());
+		painter.setPen(QColor::fromRgba(key.color));
+		painter.drawText(QRect(0, 0, 16, 16), Qt::AlignCenter, key.text);
+		painter.end();
+		icon = QPixmap::fromImage(image);
+		break;
+	}
+	case JoinedButton:
+		icon = QIcon::fromTheme(QStringLiteral("view-choose"), QIcon(QStringLiteral(":/qpathedit/icons/dialog.ico")));
+		break;
 	default:
 		Q_UNREACHABLE();
 	}
+	iconCache.insert(key, icon);
+	return icon;
+}
+
+const QSharedPointer<PerformanceCounters> &QPathEdit::localCounters()
+{
+	//most edits are never used, so their counters are only created with the first validation, completion or dialog
+	if(!perfCounters) {
+		perfCounters.reset(new PerformanceCounters());
+		pathValidator->setCounters(perfCounters);
+	}
+	return perfCounters;
+}
+
+void QPathEdit::changeEvent(QEvent *event)
+{
+	const QEvent::Type type = event->type();
+	//the key contains the color, so only a new theme makes the cached icons outdated
+	if(type == QEvent::ThemeChange)
+		clearThemeIcons();
+	if((type == QEvent::ThemeChange || type == QEvent::PaletteChange || type == QEvent::FontChange) && !hasCustomIcon)
+		dialogAction->setIcon(getDefaultIcon());
+	QWidget::changeEvent(event);
+}
+
+bool QPathEdit::eventFilter(QObject *watched, QEvent *event)
+{
+	if (event->type() == QEvent::KeyPress) {
+		QKeyEvent *keyEvent = static_cast<QKeyEvent *>(event);
+		if(keyEvent->key() == Qt::Key_Space &&
+				keyEvent->modifiers() == Qt::ControlModifier){
+			if(completerEnabled) {
+				initCompleter();
+				loadCompletionDirectory();
+				showCompletion();
+			}
+			return true;
+		} else
+			return QObject::eventFilter(watched, event);
+	} else if (event->type() == QEvent::DragEnter) {
+		QDragEnterEvent *dragEvent = static_cast<QDragEnterEvent*>(event);
+		if (!handlesDrop(dragEvent->mimeData()))
+			return false;
+
+		//decided once per drag: the names right now, the paths themselves in the background
+		dragActive = true;
+		dragPaths = acceptedDropPaths(dragEvent->mimeData());
+		dragAccepted = !dragPaths.isEmpty();
+		if (dragAccepted) {
+			checkDragPaths();
+			dragEvent->acceptProposedAction();
+		} else
+			dragEvent->ignore();
+		return true;
+	} else if (event->type() == QEvent::DragMove) {
+		QDragMoveEvent *moveEvent = static_cast<QDragMoveEvent*>(event);
+		if (!dragActive)
+			return false;
+
+		//answered from the verdict of the drag enter, so hovering does no work at all
+		if (dragAccepted)
+			moveEvent->acceptProposedAction();
+		else
+			moveEvent->ignore();
+		return true;
+	} else if (event->type() == QEvent::DragLeave) {
+		finishDrag();
+		return false;
+	} else if (event->type() == QEvent::Drop) {
+		QDropEvent *dropEvent = static_cast<QDropEvent*>(event);
+		if (!handlesDrop(dropEvent->mimeData())) {
+			finishDrag();
+			return false;
+		}
+
+		//drops without a preceding drag enter (for example synthetic ones) are checked here
+		QStringList filePaths = dragActive ? dragPaths : acceptedDropPaths(dropEvent->mimeData());
+		bool accepted = dragActive ? dragAccepted : !filePaths.isEmpty();
+		finishDrag();
+		if (!accepted) {
+			dropEvent->ignore();
+			return true;
+		}
+
+		if (mode == ExistingFiles)
+			setPaths(filePaths);
+		else
+			setPath(filePaths.first());
+		dropEvent->acceptProposedAction();
+		return true;
+	} else
+		return QObject::eventFilter(watched, event);
+}
+
+bool QPathEdit::handlesDrop(const QMimeData *mimeData) const
+{
+	//everything else, like text or several urls for a single path, is left to the line edit
+	if (!mimeData->hasUrls())
+		return false;
+	QList<QUrl> urls = mimeData->urls();
+	if (mode == ExistingFiles) {
+		foreach(const QUrl &url, urls) {
+			if (url.isLocalFile())
+				return true;
+		}
+		return false;
+	} else
+		return urls.size() == 1 && urls.first().isLocalFile();
+}
+
+QStringList QPathEdit::acceptedDropPaths(const QMimeData *mimeData) const
+{
+	QList<QUrl> urls = mimeData->urls();
+
+	//only the names are checked, so this never touches the filesystem
+	QStringList filePaths;
+	foreach(const QUrl &url, urls) {
+		if (!url.isLocalFile())
+			continue;
+		QString filePath = url.toLocalFile();
+		if ((mode == ExistingFile || mode == ExistingFiles) && !filterMatcher->isEmpty() &&
+			!filterMatcher->matches(QFileInfo(filePath).fileName()))
+			continue;
+		filePaths.append(filePath);
+	}
+	return filePaths;
+}
+
+void QPathEdit::checkDragPaths()
+{
+	const int generation = ++dragGeneration;
+	QPathValidation::Mode pathMode = static_cast<QPathValidation::Mode>(mode);
+	bool emptyAllowed = allowEmpty;
+	NameFilterMatcherPtr matcher = validateFilters ? filterMatcher : NameFilterMatcherPtr();
+	QSharedPointer<QPathFileSystemProvider> provider = fsProvider;
+	PerformanceCountersPtr counters = localCounters();
+	QStringList paths = dragPaths;
+	QStringList mimeFilters = mimeChecksActive() ? mimeFilterList : QStringList();
+
+	QFutureWatcher<QStringList> *watcher = new QFutureWatcher<QStringList>(this);
+	connect(watcher, &QFutureWatcher<QStringList>::finished, this, [this, watcher, generation](){
+		//a later drag or the drop itself might have ended this drag already
+		if(dragActive && dragGeneration == generation) {
+			dragPaths = watcher->result();
+			dragAccepted = !dragPaths.isEmpty();
+		}
+		watcher->deleteLater();
+	});
+	watcher->setFuture(QtConcurrent::run(PathChecker::threadPool(), [=](){
+		//multiple files are accepted as long as one of them is valid, and only the valid ones are dropped
+		QVector<QPathValidation::State> states = PathChecker::checkPaths(paths, pathMode, emptyAllowed, matcher, provider.data(), counters.data());
+		QStringList validPaths;
+		for(int i = 0; i < states.size(); ++i) {
+			if(states[i] != QPathValidation::Acceptable)
+				continue;
+			if(!mimeFilters.isEmpty() && !MimeTypeCache::instance()->matches(paths[i], mimeFilters))
+				continue;
+			validPaths.append(paths[i]);
+		}
+		return validPaths;
+	}));
+}
+
+void QPathEdit::finishDrag()
+{
+	dragActive = false;
+	dragAccepted = false;
+	dragPaths.clear();
+	++dragGeneration;
+}
+
+//HELPER CLASSES IMPLEMENTATION
+
+QFileDialog *FileDialogPool::checkOut(QWidget *owner)
+{
+	QFileDialog *dialog = nullptr;
+	QList<QPointer<QFileDialog>> &idle = idleDialogs();
+	while(!dialog && !idle.isEmpty())
+		dialog = idle.takeLast();
+	if(dialog) {
+		dialog->setParent(owner, dialog->windowFlags());
+		//history, sidebar and view of the previous user are dropped, so the dialog starts like a new one
+		dialog->restoreState(initialState());
+		dialog->setDefaultSuffix(QString());
+		//selectFile() ignores empty names, so the typed name of the widget based dialog is cleared directly
+		QLineEdit *nameEdit = dialog->findChild<QLineEdit*>(QStringLiteral("fileNameEdit"));
+		if(nameEdit)
+			nameEdit->clear();
+	} else {
+		dialog = new QFileDialog(owner);
+		if(initialState().isEmpty())
+			initialState() = dialog->saveState();
+	}
+	//positions and modality depend on the owner, so they are set up for every checkout
+	DialogMaster::masterDialog(dialog);
+	return dialog;
+}
+
+void FileDialogPool::checkIn(QFileDialog *dialog, bool fileSelected)
+{
+	//only one dialog is open at a time in most applications, so keeping more would only waste memory
+	QList<QPointer<QFileDialog>> &idle = idleDialogs();
+	//native dialogs keep a selected file until another one is selected, which would leak to the next user
+	const bool keepsSelection = fileSelected && !dialog->testOption(QFileDialog::DontUseNativeDialog);
+	if(idle.size() >= 2 || keepsSelection) {
+		dialog->deleteLater();
+		return;
+	}
+	dialog->hide();
+	dialog->setParent(nullptr, dialog->windowFlags());
+	idle.append(dialog);
+}
+
+QByteArray &FileDialogPool::initialState()
+{
+	static QByteArray state;
+	return state;
+}
+
+QList<QPointer<QFileDialog>> &FileDialogPool::idleDialogs()
+{
+	static QList<QPointer<QFileDialog>> dialogs;
+	static bool cleanupRegistered = false;
+	if(!cleanupRegistered && QCoreApplication::instance()) {
+		//the idle dialogs have no parent, so they are destroyed together with the application
+		QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, [](){
+			foreach(const QPointer<QFileDialog> &dialog, idleDialogs())
+				delete dialog.data();
+			idleDialogs().clear();
+		});
+		cleanupRegistered = true;
+	}
+	return dialogs;
+}
+
+bool DefaultIconKey::operator==(const DefaultIconKey &other) const
+{
+	return style == other.style &&
+			text == other.text &&
+			font == other.font &&
+			color == other.color &&
+			qFuzzyCompare(devicePixelRatio, other.devicePixelRatio);
+}
+
+uint qHash(const DefaultIconKey &key, uint seed)
+{
+	//the device pixel ratio is left out, as fuzzy equal values must get the same hash
+	return qHash(key.style, seed) ^ qHash(key.text, seed) ^ qHash(key.font, seed) ^ qHash(key.color, seed);
+}
+
+PathValidator::PathValidator(QObject *parent) :
+	QValidator(parent),
+	mode(QPathEdit::ExistingFile),
+	allowEmpty(true),
+	filterMatcher(),
+	perfCounters(),
+	separator(QLatin1Char(';')),
+	fsProvider(),
+	prefixMemo(new PrefixMemo()),
+	asyncGeneration(new QAtomicInt(0)),
+	entryMemo(),
+	entryEpoch(0),
+	entryTimer()
+{}
+
+void PathValidator::setMode(QPathEdit::PathMode mode)
+{
+	this->mode = mode;
+	entryMemo.clear();
+}
+
+void PathValidator::setAllowEmpty(bool allow)
+{
+	allowEmpty = allow;
+	entryMemo.clear();
+}
+
+void PathValidator::setFilterMatcher(const NameFilterMatcherPtr &matcher)
+{
+	filterMatcher = matcher;
+	entryMemo.clear();
+}
+
+void PathValidator::setCounters(const PerformanceCountersPtr &counters)
+{
+	perfCounters = counters;
+}
+
+void PathValidator::setSeparator(QChar separator)
+{
+	this->separator = separator;
+}
+
+void PathValidator::setFileSystemProvider(const QSharedPointer<QPathFileSystemProvider> &provider)
+{
+	fsProvider = provider;
+	entryMemo.clear();
+}
+
+QValidator::State PathValidator::validate(QString &text, int &) const
+{
+	//unverified paths can't be accepted, but must stay editable
+	QPathValidation::State state = validateState(text);
+	return state == QPathValidation::Unverified ? Intermediate : static_cast<State>(state);
+}
+
+QPathValidation::State PathValidator::validateState(const QString &text) const
+{
+	//single paths are checked directly, so typing needs no list of states
+	if(mode == QPathEdit::ExistingFiles)
+		return combineStates(validateEntries(text));
+	else
+		return PathChecker::checkPath(text, static_cast<QPathValidation::Mode>(mode), allowEmpty, filterMatcher, fsProvider.data(), perfCounters.data(), prefixMemo.data());
+}
+
+QVector<QPathValidation::State> PathValidator::validateEntries(const QString &text) const
+{
+	QPathValidation::Mode pathMode = static_cast<QPathValidation::Mode>(mode);
+	if(mode != QPathEdit::ExistingFiles)
+		return QVector<QPathValidation::State>(1, PathChecker::checkPath(text, pathMode, allowEmpty, filterMatcher, fsProvider.data(), perfCounters.data(), prefixMemo.data()));
+
+	//typing only changes one entry, so the states of the others are taken from the last text.
+	//They expire like cached stats, or as soon as any watched directory changes
+	PathStatCache *cache = PathStatCache::instance();
+	const quint64 epoch = cache->epoch();
+	const bool memoValid = entryTimer.isValid() &&
+						   entryTimer.elapsed() < cache->timeout() &&
+						   entryEpoch == epoch;
+	if(!memoValid)
+		entryMemo.clear();
+
+	QStringList paths = PathChecker::splitPaths(text, separator);
+	QVector<QPathValidation::State> states(paths.size());
+	QStringList changedPaths;
+	QVector<int> changedIndexes;
+	for(int i = 0; i < paths.size(); ++i) {
+		auto it = entryMemo.constFind(paths[i]);
+		if(it != entryMemo.constEnd())
+			states[i] = it.value();
+		else {
+			changedPaths.append(paths[i]);
+			changedIndexes.append(i);
+		}
+	}
+	if(!changedPaths.isEmpty()) {
+		QVector<QPathValidation::State> changedStates = PathChecker::checkPaths(changedPaths, pathMode, allowEmpty, filterMatcher, fsProvider.data(), perfCounters.data());
+		for(int i = 0; i < changedIndexes.size(); ++i)
+			states[changedIndexes[i]] = changedStates[i];
+	}
+
+	//only the entries of the current text are kept, and unverified ones are checked again
+	QHash<QString, QPathValidation::State> memo;
+	memo.reserve(paths.size());
+	for(int i = 0; i < paths.size(); ++i) {
+		if(states[i] != QPathValidation::Unverified)
+			memo.insert(paths[i], states[i]);
+	}
+	entryMemo = memo;
+	if(!memoValid) {
+		entryEpoch = epoch;
+		entryTimer.start();
+	}
+	return states;
+}
+
+QPathValidation::State PathValidator::combineStates(const QVector<QPathValidation::State> &states) const
+{
+	return PathChecker::combineStates(states, static_cast<QPathValidation::Mode>(mode), allowEmpty);
+}
+
+void PathValidator::validateAsync(const QString &text)
+{
+	const int generation = asyncGeneration->fetchAndAddOrdered(1) + 1;
+	QSharedPointer<QAtomicInt> latestGeneration = asyncGeneration;
+	QPathValidation::Mode pathMode = static_cast<QPathValidation::Mode>(mode);
+	bool emptyAllowed = allowEmpty;
+	NameFilterMatcherPtr matcher = filterMatcher;
+	QSharedPointer<QPathFileSystemProvider> provider = fsProvider;
+	PerformanceCountersPtr counters = perfCounters;
+	QSharedPointer<PrefixMemo> memo = prefixMemo;
+	QStringList paths;
+	if(pathMode == QPathValidation::ExistingFiles)
+		paths = PathChecker::splitPaths(text, separator);
+
+	typedef QVector<QPathValidation::State> StateList;
+	QFutureWatcher<StateList> *watcher = new QFutureWatcher<StateList>(this);
+	connect(watcher, &QFutureWatcher<StateList>::finished, this, [this, watcher, text, generation](){
+		if(asyncGeneration->load() == generation) {
+			StateList states = watcher->result();
+			emit asyncValidated(text, combineStates(states), states);
+		}
+		watcher->deleteLater();
+	});
+	watcher->setFuture(QtConcurrent::run(PathChecker::threadPool(), [=]() -> StateList {
+		//skip the stat calls if newer text arrived while this request was queued
+		if(latestGeneration->load() != generation)
+			return StateList();
+		if(pathMode == QPathValidation::ExistingFiles)
+			return PathChecker::checkPaths(paths, pathMode, emptyAllowed, matcher, provider.data(), counters.data());
+		else
+			return StateList(1, PathChecker::checkPath(text, pathMode, emptyAllowed, matcher, provider.data(), counters.data(), memo.data()));
+	}));
+}
+
+void PathValidator::cancelAsync()
+{
+	asyncGeneration->ref();
+}
 
-	return QValidator::Invalid;
+DirectoryLister::DirectoryLister(const QSharedPointer<QPathFileSystemProvider> &provider) :
+	QObject(),
+	fsProvider(provider),
+	clock(),
+	cache(),
+	cacheOrder(),
+	cachedEntries(0),
+	pending()
+{
+	clock.start();
+	//huge directories should not block all other listings, but neither flood the disk
+	listingPool()->setMaxThreadCount(2);
+	//prefetches have their own pool, so they never delay the directory the user is typing in
+	prefetchPool()->setMaxThreadCount(2);
+	//other providers report their changes, so their listings are dropped right away
+	if(fsProvider) {
+		connect(fsProvider.data(), &QPathFileSystemProvider::directoryChanged,
+				this, &DirectoryLister::removeListing);
+	}
+}
+
+DirectoryLister::~DirectoryLister()
+{
+	//listings nobody waits for anymore are stopped between two chunks
+	foreach(QFutureWatcher<DirectoryChunk> *watcher, findChildren<QFutureWatcher<DirectoryChunk>*>())
+		watcher->cancel();
+	if(fsProvider) {
+		foreach(const QString &dirPath, cacheOrder)
+			fsProvider->unwatch(dirPath);
+	}
+	//the entry is only dropped if no new lister took the place of this one
+	if(!sharedListers.isDestroyed()) {
+		auto it = sharedListers->find(fsProvider.data());
+		if(it != sharedListers->end() && it.value().isNull())
+			sharedListers->erase(it);
+	}
+}
+
+QSharedPointer<DirectoryLister> DirectoryLister::instance(const QSharedPointer<QPathFileSystemProvider> &provider)
+{
+	//one lister per provider, as long as any edit uses it. The lister keeps the provider alive, so the key stays unique
+	QSharedPointer<DirectoryLister> lister = sharedListers->value(provider.data()).toStrongRef();
+	if(!lister) {
+		lister.reset(new DirectoryLister(provider));
+		sharedListers->insert(provider.data(), lister);
+	}
+	return lister;
+}
+
+DirectoryLister::Listing DirectoryLister::cachedListing(const QString &dirPath)
+{
+	auto it = cache.find(dirPath);
+	if(it == cache.end())
+		return Listing();
+	//local listings expire together with the stat results, as they are not watched
+	if(!fsProvider && clock.elapsed() - it->timestamp > PathStatCache::instance()->timeout()) {
+		removeListing(dirPath);
+		return Listing();
+	}
+	return it->listing;
+}
+
+void DirectoryLister::requestListing(const QString &dirPath, bool prefetch)
+{
+	if(pending.contains(dirPath))
+		return;
+	pending.insert(dirPath);
+	if(prefetch)
+		PerformanceCounters::count(nullptr, QPathEditStatistics::DirectoryPrefetches);
+
+	QFutureInterface<DirectoryChunk> future;
+	future.reportStarted();
+	QFutureWatcher<DirectoryChunk> *watcher = new QFutureWatcher<DirectoryChunk>(this);
+	connect(watcher, &QFutureWatcher<DirectoryChunk>::resultReadyAt, this, [this, watcher, dirPath](int index){
+		DirectoryChunk chunk = watcher->resultAt(index);
+		if(!chunk.listing) {
+			emit entriesRead(dirPath, *chunk.entries);
+			return;
+		}
+		pending.remove(dirPath);
+
+		CacheEntry entry;
+		entry.listing = chunk.listing;
+		entry.timestamp = clock.elapsed();
+		auto cached = cache.find(dirPath);
+		if(cached != cache.end())
+			cachedEntries -= cached->listing->entries.size();
+		else if(fsProvider)
+			fsProvider->watch(dirPath);
+		cache.insert(dirPath, entry);
+		cachedEntries += entry.listing->entries.size();
+		cacheOrder.removeOne(dirPath);
+		cacheOrder.append(dirPath);
+		//huge directories would keep millions of entries alive, so they are only held by the models using them
+		while(cacheOrder.size() > 16 || cachedEntries > MaxCachedEntries)
+			removeListing(cacheOrder.first());
+
+		emit listingReady(dirPath, chunk.listing);
+	});
+	connect(watcher, &QFutureWatcher<DirectoryChunk>::finished, this, [this, watcher, dirPath](){
+		if(watcher->isCanceled())
+			pending.remove(dirPath);
+		watcher->deleteLater();
+	});
+	watcher->setFuture(future.future());
+	QtConcurrent::run(prefetch ? prefetchPool() : listingPool(),
+					  &DirectoryLister::readDirectory, future, dirPath, fsProvider);
+}
+
+void DirectoryLister::markUsed(const QString &dirPath)
+{
+	auto it = usage.find(dirPath);
+	if(it == usage.end()) {
+		//only the most recently used directories are remembered
+		if(usage.size() >= 1024) {
+			auto oldest = usage.begin();
+			for(auto usageIt = usage.begin(); usageIt != usage.end(); ++usageIt) {
+				if(usageIt->lastUse < oldest->lastUse)
+					oldest = usageIt;
+			}
+			usage.erase(oldest);
+		}
+		it = usage.insert(dirPath, Usage {0, 0});
+	}
+	++it->count;
+	it->lastUse = clock.elapsed();
+}
+
+void DirectoryLister::prefetch(const DirectoryLister::Listing &listing, int count)
+{
+	QString dirPrefix = listing->dirPath;
+	if(!dirPrefix.endsWith(QLatin1Char('/')))
+		dirPrefix.append(QLatin1Char('/'));
+	auto isDirectory = [&listing](const QStringRef &name) {
+		auto it = std::lower_bound(listing->entries.constBegin(), listing->entries.constEnd(), name, [](const DirectoryEntry &entry, const QStringRef &value){
+			return entry.name < value;
+		});
+		return it != listing->entries.constEnd() && it->name == name && (it->type & DirectoryEntry::Dir);
+	};
+
+	//the subdirectories used most often and most recently come first
+	QVector<QPair<Usage, QString>> used;
+	for(auto it = usage.constBegin(); it != usage.constEnd(); ++it) {
+		const QString &path = it.key();
+		if(path.size() > dirPrefix.size() &&
+		   path.startsWith(dirPrefix) &&
+		   path.indexOf(QLatin1Char('/'), dirPrefix.size()) == -1 &&
+		   isDirectory(path.midRef(dirPrefix.size())))
+			used.append(qMakePair(it.value(), path));
+	}
+	std::sort(used.begin(), used.end(), [](const QPair<Usage, QString> &lhs, const QPair<Usage, QString> &rhs){
+		if(lhs.first.count != rhs.first.count)
+			return lhs.first.count > rhs.first.count;
+		else
+			return lhs.first.lastUse > rhs.first.lastUse;
+	});
+
+	QStringList candidates;
+	for(int i = 0; i < used.size() && candidates.size() < count; ++i)
+		candidates.append(used[i].second);
+	//without enough history, the first subdirectories by name are guessed
+	for(int i = 0; i < listing->entries.size() && candidates.size() < count; ++i) {
+		const DirectoryEntry &entry = listing->entries[i];
+		if(!(entry.type & DirectoryEntry::Dir))
+			continue;
+		QString path = dirPrefix + entry.name;
+		if(!candidates.contains(path))
+			candidates.append(path);
+	}
+
+	foreach(const QString &path, candidates) {
+		if(!cache.contains(path))
+			requestListing(path, true);
+	}
+}
+
+void DirectoryLister::removeListing(const QString &dirPath)
+{
+	auto it = cache.find(dirPath);
+	if(it == cache.end())
+		return;
+	cachedEntries -= it->listing->entries.size();
+	cache.erase(it);
+	cacheOrder.removeOne(dirPath);
+	if(fsProvider)
+		fsProvider->unwatch(dirPath);
+}
+
+void DirectoryLister::readDirectory(QFutureInterface<DirectoryChunk> future, const QString &dirPath, const QSharedPointer<QPathFileSystemProvider> &provider)
+{
+	QSharedPointer<DirectoryListing> listing(new DirectoryListing());
+	listing->dirPath = dirPath;
+
+	//the first entries are handed out right away, so the completer can show them while the rest is read.
+	//Later chunks grow, to keep the main thread from handling millions of tiny ones.
+	//The chunks are shared with the future and only joined into the listing once everything was read
+	QVector<QSharedPointer<const QVector<DirectoryEntry>>> chunks;
+	QSharedPointer<QVector<DirectoryEntry>> current(new QVector<DirectoryEntry>());
+	int total = 0;
+	int chunkSize = 256;
+	auto reportChunk = [&](){
+		++total;
+		if(current->size() < chunkSize)
+			return;
+		DirectoryChunk chunk;
+		chunk.entries = current;
+		future.reportResult(chunk);
+		chunks.append(current);
+		current.reset(new QVector<DirectoryEntry>());
+		chunkSize = qMin(chunkSize * 4, 16384);
+	};
+
+	if(provider) {
+		foreach(const QPathFileSystemProvider::Entry &providerEntry, provider->entries(dirPath)) {
+			if(providerEntry.type == QPathFileSystemProvider::NoEntry)
+				continue;
+			DirectoryEntry entry;
+			entry.name = providerEntry.name;
+			entry.type = providerEntry.type == QPathFileSystemProvider::Directory ? DirectoryEntry::Dir : DirectoryEntry::File;
+			if(providerEntry.isSymLink)
+				entry.type |= DirectoryEntry::SymLink;
+			current->append(entry);
+			reportChunk();
+		}
+	} else {
+		//the iterator fills the file infos from the directory entries, so no extra stat per entry is needed
+		QDirIterator iterator(dirPath, QDir::AllEntries | QDir::NoDotAndDotDot);
+		while(iterator.hasNext() && !future.isCanceled()) {
+			iterator.next();
+			QFileInfo info = iterator.fileInfo();
+			DirectoryEntry entry;
+			entry.name = iterator.fileName();
+			entry.type = info.isDir() ? DirectoryEntry::Dir : DirectoryEntry::File;
+			if(info.isSymLink())
+				entry.type |= DirectoryEntry::SymLink;
+			current->append(entry);
+			reportChunk();
+		}
+	}
+
+	if(future.isCanceled()) {
+		future.reportFinished();
+		return;
+	}
+
+	chunks.append(current);
+	current.reset();
+	listing->entries.reserve(total);
+	foreach(const QSharedPointer<const QVector<DirectoryEntry>> &chunkEntries, chunks)
+		listing->entries += *chunkEntries;
+	chunks.clear();
+
+	std::sort(listing->entries.begin(), listing->entries.end(), [](const DirectoryEntry &lhs, const DirectoryEntry &rhs){
+		return lhs.name < rhs.name;
+	});
+
+	listing->charMasks.reserve(listing->entries.size());
+	foreach(const DirectoryEntry &entry, listing->entries)
+		listing->charMasks.append(fuzzyCharMask(entry.name));
+
+	DirectoryChunk chunk;
+	chunk.listing = listing;
+	future.reportResult(chunk);
+	future.reportFinished();
+}
+
+DirectoryListModel::DirectoryListModel(const QSharedPointer<QPathFileSystemProvider> &provider, QObject *parent) :
+	QAbstractListModel(parent),
+	lister(DirectoryLister::instance(provider)),
+	localEntries(!provider),
+	dirPath(),
+	prefix(),
+	listing(),
+	rows(),
+	allRows(false),
+	streamed(),
+	namePrefix(),
+	mode(QPathEdit::ExistingFile),
+	filterMatcher(),
+	fuzzy(false),
+	fuzzyLimit(50),
+	fuzzyPattern(),
+	prefetchCount(0),
+	iconMode(QPathEdit::FileIcons),
+	iconLoader(new EntryIconLoader(this))
+{
+	connect(lister.data(), &DirectoryLister::listingReady,
+			this, &DirectoryListModel::listingReady);
+	connect(lister.data(), &DirectoryLister::entriesRead,
+			this, &DirectoryListModel::entriesRead);
+	connect(iconLoader, &EntryIconLoader::iconsLoaded,
+			this, &DirectoryListModel::iconsLoaded);
+}
+
+QString DirectoryListModel::directory() const
+{
+	return dirPath;
+}
+
+void DirectoryListModel::setDirectory(const QString &dirPath, const QString &completionPrefix)
+{
+	if(this->dirPath == dirPath && prefix == completionPrefix)
+		return;
+
+	const bool dirChanged = this->dirPath != dirPath;
+	beginResetModel();
+	this->dirPath = dirPath;
+	prefix = completionPrefix;
+	listing = lister->cachedListing(dirPath);
+	if(dirChanged) {
+		streamed.clear();
+		//icons of the old directory are not visible anymore
+		iconLoader->clearPending();
+	}
+	updateRows();
+	endResetModel();
+
+	if(dirChanged)
+		lister->markUsed(dirPath);
+	if(listing) {
+		emit directoryLoaded(dirPath);
+		if(dirChanged && prefetchCount > 0)
+			lister->prefetch(listing, prefetchCount);
+	} else
+		lister->requestListing(dirPath);
+}
+
+void DirectoryListModel::setMode(QPathEdit::PathMode mode)
+{
+	beginResetModel();
+	this->mode = mode;
+	updateRows();
+	endResetModel();
+}
+
+void DirectoryListModel::setFilterMatcher(const NameFilterMatcherPtr &matcher)
+{
+	beginResetModel();
+	filterMatcher = matcher;
+	updateRows();
+	endResetModel();
+}
+
+bool DirectoryListModel::hasListing() const
+{
+	return !listing.isNull();
+}
+
+void DirectoryListModel::setFuzzyCompletion(bool enabled, int limit)
+{
+	beginResetModel();
+	fuzzy = enabled;
+	fuzzyLimit = limit;
+	updateRows();
+	endResetModel();
+}
+
+void DirectoryListModel::setPrefetchCount(int count)
+{
+	prefetchCount = count;
+}
+
+void DirectoryListModel::setFuzzyPattern(const QString &pattern)
+{
+	if(fuzzyPattern == pattern)
+		return;
+
+	beginResetModel();
+	fuzzyPattern = pattern;
+	updateRows();
+	endResetModel();
+}
+
+void DirectoryListModel::setNamePrefix(const QString &namePrefix)
+{
+	if(this->namePrefix == namePrefix)
+		return;
+
+	this->namePrefix = namePrefix;
+	//the completer filters complete listings itself, only the entries streamed so far are narrowed down.
+	//Entries that were dropped for an earlier prefix come back with the complete listing
+	if(!listing && !streamed.isEmpty()) {
+		beginResetModel();
+		updateRows();
+		endResetModel();
+	}
+}
+
+void DirectoryListModel::setIconMode(QPathEdit::CompleterIcons iconMode)
+{
+	this->iconMode = iconMode;
+	iconLoader->clearPending();
+}
+
+int DirectoryListModel::rowCount(const QModelIndex &parent) const
+{
+	if(parent.isValid())
+		return 0;
+	else if(!listing)
+		return streamed.size();
+	else if(allRows)
+		return listing->entries.size();
+	else
+		return rows.size();
+}
+
+QVariant DirectoryListModel::data(const QModelIndex &index, int role) const
+{
+	if(!index.isValid() || index.row() >= rowCount())
+		return QVariant();
+
+	const DirectoryEntry &entry = !listing ? streamed[index.row()] :
+								  allRows ? listing->entries[index.row()] :
+								  listing->entries[rows[index.row()]];
+	switch(role) {
+	case Qt::DisplayRole:
+		return entry.name;
+	case Qt::EditRole:
+		return QString(prefix + entry.name);
+	case Qt::DecorationRole:
+		return entryIcon(entry);
+	default:
+		return QVariant();
+	}
+}
+
+void DirectoryListModel::listingReady(const QString &dirPath, const DirectoryLister::Listing &listing)
+{
+	if(this->dirPath != dirPath)
+		return;
+
+	beginResetModel();
+	this->listing = listing;
+	streamed.clear();
+	updateRows();
+	endResetModel();
+	emit directoryLoaded(dirPath);
+	//while the user still looks at this directory, the ones likely typed into next are listed
+	if(prefetchCount > 0)
+		lister->prefetch(listing, prefetchCount);
+}
+
+void DirectoryListModel::entriesRead(const QString &dirPath, const QVector<DirectoryEntry> &entries)
+{
+	if(this->dirPath != dirPath || listing)
+		return;
+
+	QVector<DirectoryEntry> matches = streamMatches(entries);
+	const bool unchanged = matches.size() == streamed.size() &&
+						   std::equal(matches.constBegin(), matches.constEnd(), streamed.constBegin(),
+									  [](const DirectoryEntry &lhs, const DirectoryEntry &rhs){
+		return lhs.name == rhs.name;
+	});
+	if(unchanged)
+		return;
+
+	const bool wasEmpty = streamed.isEmpty();
+	beginResetModel();
+	streamed = matches;
+	endResetModel();
+	//the popup is shown with the first matches, and then updates with the model
+	if(wasEmpty)
+		emit directoryLoaded(dirPath);
+}
+
+void DirectoryListModel::iconsLoaded()
+{
+	//the view only repaints the visible rows, which are the ones the icons were loaded for
+	if(rowCount() > 0)
+		emit dataChanged(index(0), index(rowCount() - 1), {Qt::DecorationRole});
+}
+
+void DirectoryListModel::updateRows()
+{
+	rows.clear();
+	allRows = false;
+	if(!listing) {
+		streamed = streamMatches(QVector<DirectoryEntry>());
+		return;
+	}
+	if(fuzzy) {
+		updateFuzzyRows();
+		return;
+	}
+
+	//without a filter every entry is a row, which saves one index per entry on huge directories
+	if(mode != QPathEdit::ExistingFolder && (!filterMatcher || filterMatcher->isEmpty())) {
+		allRows = true;
+		return;
+	}
+
+	rows.reserve(listing->entries.size());
+	for(int i = 0; i < listing->entries.size(); ++i) {
+		if(acceptsEntry(listing->entries[i]))
+			rows.append(i);
+	}
+}
+
+void DirectoryListModel::updateFuzzyRows()
+{
+	const int count = listing->entries.size();
+	if(fuzzyPattern.isEmpty()) {
+		for(int i = 0; i < count && rows.size() < fuzzyLimit; ++i) {
+			if(acceptsEntry(listing->entries[i]))
+				rows.append(i);
+		}
+		return;
+	}
+
+	//first pass: cheap rejection of all names that lack one of the patterns characters.
+	//It only works on the plain mask array, so the compiler can vectorize it
+	const QString lowerPattern = fuzzyPattern.toLower();
+	const quint64 patternMask = fuzzyCharMask(lowerPattern);
+	const quint64 *masks = listing->charMasks.constData();
+	QVector<quint8> candidates(count);
+	quint8 *candidateData = candidates.data();
+	for(int i = 0; i < count; ++i)
+		candidateData[i] = (patternMask & ~masks[i]) == 0;
+
+	//second pass: score the remaining names
+	QVector<QPair<int, int>> scored;
+	for(int i = 0; i < count; ++i) {
+		if(!candidateData[i])
+			continue;
+		const DirectoryEntry &entry = listing->entries[i];
+		if(!acceptsEntry(entry))
+			continue;
+		int score = fuzzyScore(fuzzyPattern, lowerPattern, entry.name);
+		if(score >= 0)
+			scored.append(qMakePair(-score, i));//negated, so the best matches sort first
+	}
+
+	int resultCount = qBound(0, fuzzyLimit, scored.size());
+	std::partial_sort(scored.begin(), scored.begin() + resultCount, scored.end());
+	rows.reserve(resultCount);
+	for(int i = 0; i < resultCount; ++i)
+		rows.append(scored[i].second);
+}
+
+QVector<DirectoryEntry> DirectoryListModel::streamMatches(const QVector<DirectoryEntry> &entries) const
+{
+	//while a directory is read, only the best matches so far are kept. Each chunk is only checked
+	//together with them, never with everything that was read before
+	const bool ranked = fuzzy && !fuzzyPattern.isEmpty();
+	const QString lowerPattern = fuzzyPattern.toLower();
+	QVector<QPair<int, DirectoryEntry>> candidates;
+	candidates.reserve(streamed.size() + entries.size());
+	auto addCandidate = [&](const DirectoryEntry &entry){
+		if(!acceptsEntry(entry))
+			return;
+		if(ranked) {
+			int score = fuzzyScore(fuzzyPattern, lowerPattern, entry.name);
+			if(score >= 0)
+				candidates.append(qMakePair(-score, entry));//negated, so the best matches sort first
+		} else if(fuzzy || entry.name.startsWith(namePrefix))
+			candidates.append(qMakePair(0, entry));
+	};
+	foreach(const DirectoryEntry &entry, streamed)
+		addCandidate(entry);
+	foreach(const DirectoryEntry &entry, entries)
+		addCandidate(entry);
+
+	//the completer needs the names sorted, and the popup never shows more than a screen full anyway
+	const int resultCount = qBound(0, fuzzy ? fuzzyLimit : 256, candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + resultCount, candidates.end(),
+					  [](const QPair<int, DirectoryEntry> &lhs, const QPair<int, DirectoryEntry> &rhs){
+		return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second.name < rhs.second.name);
+	});
+	QVector<DirectoryEntry> matches;
+	matches.reserve(resultCount);
+	for(int i = 0; i < resultCount; ++i)
+		matches.append(candidates[i].second);
+	return matches;
+}
+
+bool DirectoryListModel::acceptsEntry(const DirectoryEntry &entry) const
+{
+	if(entry.type & DirectoryEntry::Dir)
+		return true;
+	if(mode == QPathEdit::ExistingFolder)
+		return false;
+	if(!filterMatcher)
+		return true;
+	else
+		return filterMatcher->matches(entry.name);
+}
+
+QVariant DirectoryListModel::entryIcon(const DirectoryEntry &entry) const
+{
+	switch(iconMode) {
+	case QPathEdit::NoIcons:
+		return QVariant();
+	case QPathEdit::FileIcons:
+		//the icon provider only knows the local filesystem
+		if(localEntries)
+			return iconLoader->icon(QDir(dirPath).filePath(entry.name), entry.type);
+		return entryTypeIcon(entry.type);
+	default:
+		return entryTypeIcon(entry.type);
+	}
+}
+
+EntryIconLoader::EntryIconLoader(QObject *parent) :
+	QObject(parent),
+	pending(),
+	loadTimer(new QTimer(this)),
+	loadWatcher(new QFutureWatcher<QHash<QString, QIcon>>(this))
+{
+	//one thread is enough, icons are only loaded for the few visible rows
+	iconPool()->setMaxThreadCount(1);
+	//the rows requested by one paint event are loaded together
+	loadTimer->setSingleShot(true);
+	loadTimer->setInterval(0);
+	connect(loadTimer, &QTimer::timeout, this, &EntryIconLoader::loadPending);
+	connect(loadWatcher, &QFutureWatcherBase::finished, this, &EntryIconLoader::loadFinished);
+}
+
+QIcon EntryIconLoader::icon(const QString &path, quint8 type)
+{
+	QIcon *icon = iconCache().object(path);
+	if(icon)
+		return icon->isNull() ? entryTypeIcon(type) : *icon;
+
+	//the type icon stands in until the real one is loaded
+	pending.insert(path);
+	if(!loadWatcher->isRunning())
+		loadTimer->start();
+	return entryTypeIcon(type);
+}
+
+void EntryIconLoader::clearPending()
+{
+	pending.clear();
+	loadTimer->stop();
+}
+
+void EntryIconLoader::loadPending()
+{
+	if(pending.isEmpty() || loadWatcher->isRunning())
+		return;
+	QStringList paths = pending.values();
+	pending.clear();
+	loadWatcher->setFuture(QtConcurrent::run(iconPool(), &EntryIconLoader::loadIcons, paths));
+}
+
+void EntryIconLoader::loadFinished()
+{
+	QHash<QString, QIcon> icons = loadWatcher->result();
+	for(auto it = icons.constBegin(); it != icons.constEnd(); ++it)
+		iconCache().insert(it.key(), new QIcon(it.value()));
+	emit iconsLoaded();
+	//rows that became visible while loading are loaded next
+	if(!pending.isEmpty())
+		loadTimer->start();
+}
+
+QCache<QString, QIcon> &EntryIconLoader::iconCache()
+{
+	//only used from the GUI thread, the loaders of all edits share it
+	static QCache<QString, QIcon> cache(4096);
+	return cache;
+}
+
+QHash<QString, QIcon> EntryIconLoader::loadIcons(const QStringList &paths)
+{
+	//the gatherer of QFileSystemModel resolves its icons on a worker thread the same way
+	static QFileIconProvider iconProvider;
+	QHash<QString, QIcon> icons;
+	foreach(const QString &path, paths)
+		icons.insert(path, iconProvider.icon(QFileInfo(path)));
+	return icons;
+}
+
+static QPathEdit::ValidationState toValidationState(QPathValidation::State state)
+{
+	switch(state) {
+	case QPathValidation::Acceptable:
+		return QPathEdit::Valid;
+	case QPathValidation::Unverified:
+		return QPathEdit::Unverified;
+	default:
+		return QPathEdit::Invalid;
+	}
+}
+
+static QHash<DefaultIconKey, QIcon> &defaultIconCache()
+{
+	static QHash<DefaultIconKey, QIcon> iconCache;
+	static bool cleanupRegistered = false;
+	if(!cleanupRegistered && QCoreApplication::instance()) {
+		//the pixmaps must not outlive the application
+		QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, [](){
+			defaultIconCache().clear();
+		});
+		cleanupRegistered = true;
+	}
+	return iconCache;
+}
+
+static void clearThemeIcons()
+{
+	//every widget gets the change in one go, so only the first one clears and the others reuse its icons
+	static bool cleared = false;
+	if(cleared)
+		return;
+	cleared = true;
+	defaultIconCache().clear();
+	QTimer::singleShot(0, [](){
+		cleared = false;
+	});
+}
+
+static QIcon entryTypeIcon(quint8 type)
+{
+	static QFileIconProvider iconProvider;
+	static const QIcon folderIcon = iconProvider.icon(QFileIconProvider::Folder);
+	static const QIcon fileIcon = iconProvider.icon(QFileIconProvider::File);
+	//the provider has no icon for links, so the theme one is used if there is any
+	static const QIcon linkIcon = QIcon::fromTheme(QStringLiteral("inode-symlink"));
+	if((type & DirectoryEntry::SymLink) && !linkIcon.isNull())
+		return linkIcon;
+	return (type & DirectoryEntry::Dir) ? folderIcon : fileIcon;
+}
+
+static quint64 fuzzyCharMask(const QString &text)
+{
+	//one bit per letter and digit, all other characters share the remaining bits
+	quint64 mask = 0;
+	foreach(const QChar &c, text) {
+		ushort code = c.toLower().unicode();
+		int bit;
+		if(code >= 'a' && code <= 'z')
+			bit = code - 'a';
+		else if(code >= '0' && code <= '9')
+			bit = 26 + code - '0';
+		else
+			bit = 36 + code % 28;
+		mask |= Q_UINT64_C(1) << bit;
+	}
+	return mask;
+}
+
+static int fuzzyScore(const QString &pattern, const QString &lowerPattern, const QString &name)
+{
+	const int patternSize = lowerPattern.size();
+	const int nameSize = name.size();
+	if(patternSize > nameSize)
+		return -1;
+
+	const QChar *patternData = lowerPattern.constData();
+	const QChar *nameData = name.constData();
+	int score = 0;
+	int patternIndex = 0;
+	int consecutive = 0;
+	int firstMatch = -1;
+	for(int i = 0; i < nameSize && patternIndex < patternSize; ++i) {
+		const QChar c = nameData[i];
+		if(c.toLower() != patternData[patternIndex]) {
+			consecutive = 0;
+			continue;
+		}
+
+		int charScore = 1;
+		if(i == 0)
+			charScore += 8;
+		else {
+			const QChar previous = nameData[i - 1];
+			if(previous == QLatin1Char('.') ||
+			   previous == QLatin1Char('_') ||
+			   previous == QLatin1Char('-') ||
+			   previous == QLatin1Char(' '))
+				charScore += 6;
+			else if(previous.isLower() && c.isUpper())//camel case word start
+				charScore += 4;
+		}
+		if(c == pattern[patternIndex])//exact case
+			charScore += 1;
+		charScore += qMin(consecutive, 4) * 3;
+
+		if(firstMatch < 0)
+			firstMatch = i;
+		++consecutive;
+		++patternIndex;
+		score += charScore;
+	}
+
+	if(patternIndex < patternSize)
+		return -1;
+	//prefer matches that start early in short names
+	score -= qMin(firstMatch, 8);
+	score -= (nameSize - patternSize) / 8;
+	return qMax(score, 0);
+}
+
+PathCompleter::PathCompleter(QObject *parent) :
+	QCompleter(parent)
+{
+	//QCompleter::setModel only sets these up for a plain QFileSystemModel, not for the proxy
+#ifdef Q_OS_WIN
+	setCaseSensitivity(Qt::CaseInsensitive);
+#endif
+	setCompletionRole(QFileSystemModel::FileNameRole);
+}
+
+QStringList PathCompleter::splitPath(const QString &path) const
+{
+	// the completer only knows the proxy, so the QFileSystemModel specific splitting of QCompleter is replicated here
+	if(path.isEmpty())
+		return QStringList(completionPrefix());
+
+	QString pathCopy = QDir::toNativeSeparators(path);
+	const QChar sep = QDir::separator();
+#ifdef Q_OS_WIN
+	if(pathCopy == QStringLiteral("\\") || pathCopy == QStringLiteral("\\\\"))
+		return QStringList(pathCopy);
+	QString doubleSlash(QStringLiteral("\\\\"));
+	if(pathCopy.startsWith(doubleSlash))
+		pathCopy = pathCopy.mid(2);
+	else
+		doubleSlash.clear();
+#endif
+
+	QStringList parts = pathCopy.split(sep);
+#ifdef Q_OS_WIN
+	if(!doubleSlash.isEmpty())
+		parts[0].prepend(doubleSlash);
+#else
+	if(pathCopy[0] == sep)//readd the "/" at the beginning as the split removed it
+		parts[0] = QStringLiteral("/");
+#endif
+	return parts;
+}
+
+QString PathCompleter::pathFromIndex(const QModelIndex &index) const
+{
+	if(!index.isValid())
+		return QString();
+
+	QStringList list;
+	QModelIndex idx = index;
+	do {
+		list.prepend(idx.data(QFileSystemModel::FileNameRole).toString());
+		QModelIndex parent = idx.parent();
+		idx = parent.sibling(parent.row(), index.column());
+	} while(idx.isValid());
+
+#ifndef Q_OS_WIN
+	if(list.count() == 1)//only the separator or some other text
+		return list.first();
+	list[0].clear();//the join below will provide the separator
+#endif
+	return list.join(QDir::separator());
+}
+
+QIcon NoIconProvider::icon(QFileIconProvider::IconType) const
+{
+	return QIcon();
+}
+
+QIcon NoIconProvider::icon(const QFileInfo &) const
+{
+	return QIcon();
+}
+
+CompleterFilterModel::CompleterFilterModel(QPathEdit::CompleterIcons iconMode, QObject *parent) :
+	QSortFilterProxyModel(parent),
+	fsModel(sharedFileSystemModel(iconMode == QPathEdit::FileIcons)),
+	mode(QPathEdit::ExistingFile),
+	filterMatcher(),
+	iconMode(iconMode)
+{
+	setSourceModel(fsModel.data());
+}
+
+CompleterFilterModel::~CompleterFilterModel()
+{
+	//detach before the shared model might get destroyed with the last reference
+	setSourceModel(nullptr);
+}
+
+QFileSystemModel *CompleterFilterModel::fileSystemModel() const
+{
+	return fsModel.data();
+}
+
+void CompleterFilterModel::setMode(QPathEdit::PathMode mode)
+{
+	this->mode = mode;
+	invalidateFilter();
+}
+
+void CompleterFilterModel::setFilterMatcher(const NameFilterMatcherPtr &matcher)
+{
+	filterMatcher = matcher;
+	invalidateFilter();
+}
+
+void CompleterFilterModel::setIconMode(QPathEdit::CompleterIcons iconMode)
+{
+	//switching from or to FileIcons needs the other shared model, so the edit recreates this one instead
+	this->iconMode = iconMode;
+}
+
+QVariant CompleterFilterModel::data(const QModelIndex &index, int role) const
+{
+	//the model loads the real icons on its own gatherer thread already, the other one has none
+	if(role != Qt::DecorationRole || iconMode == QPathEdit::FileIcons)
+		return QSortFilterProxyModel::data(index, role);
+	if(iconMode == QPathEdit::NoIcons)
+		return QVariant();
+
+	QModelIndex sourceIndex = mapToSource(index);
+	quint8 type = fsModel->isDir(sourceIndex) ? DirectoryEntry::Dir : DirectoryEntry::File;
+	if(fsModel->fileInfo(sourceIndex).isSymLink())
+		type |= DirectoryEntry::SymLink;
+	return entryTypeIcon(type);
+}
+
+bool CompleterFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+	QModelIndex index = fsModel->index(sourceRow, 0, sourceParent);
+	if(fsModel->isDir(index))
+		return true;
+	if(mode == QPathEdit::ExistingFolder)
+		return false;
+	if(!filterMatcher)
+		return true;
+	else
+		return filterMatcher->matches(fsModel->fileName(index));
+}
+
+QSharedPointer<QFileSystemModel> CompleterFilterModel::sharedFileSystemModel(bool withIcons)
+{
+	//one model (and thus one gatherer thread and cache) for all edits, destroyed with the last reference
+	//the gatherer resolves an icon for every entry it loads, so edits that show none share a model without them
+	static QWeakPointer<QFileSystemModel> iconModel;
+	static QWeakPointer<QFileSystemModel> noIconModel;
+	QWeakPointer<QFileSystemModel> &sharedModel = withIcons ? iconModel : noIconModel;
+	QSharedPointer<QFileSystemModel> model = sharedModel.toStrongRef();
+	if(!model) {
+		if(withIcons)
+			model.reset(new QFileSystemModel());
+		else {
+			//the provider must outlive the gatherer thread, which only stops when the model is destroyed
+			NoIconProvider *provider = new NoIconProvider();
+			model.reset(new QFileSystemModel(), [provider](QFileSystemModel *fsModel){
+				delete fsModel;
+				delete provider;
+			});
+			model->setIconProvider(provider);
+		}
+		model->setFilter(QDir::AllEntries | QDir::AllDirs | QDir::NoDotAndDotDot);
+		model->setRootPath(QString());
+		sharedModel = model;
+	}
+	return model;
 }
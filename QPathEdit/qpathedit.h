@@ -7,6 +7,13 @@
 #include <QIcon>
 #include <QString>
 #include <QPointer>
+#include <QSharedPointer>
+#include <QValidator>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QHash>
+#include "qpatheditstatistics.h"
+#include "qpathvalidation.h"
 
 #ifdef DESIGNER_PLUGIN
 #include <QDesignerExportWidget>
@@ -18,8 +25,13 @@
 class QLineEdit;
 class QCompleter;
 class PathValidator;
-class QFileSystemModel;
+class NameFilterMatcher;
+class CompleterFilterModel;
+class DirectoryListModel;
 class QToolButton;
+class QTimer;
+class PerformanceCounters;
+class QMimeData;
 
 //! The QPathEdit provides a simple way to get a path from the user as comfortable as possible
 class DESIGNER_PLUGIN_EXPORT QPathEdit : public QWidget
@@ -54,6 +66,30 @@ class DESIGNER_PLUGIN_EXPORT QPathEdit : public QWidget
 	Q_PROPERTY(QStringList nameFilters READ nameFilters WRITE setNameFilters)
 	//! Holds mime filters for the dialog and the completer
 	Q_PROPERTY(QStringList mimeTypeFilters READ mimeTypeFilters WRITE setMimeTypeFilters)
+	//! Specifies whether the validator only accepts files that match the name filters
+	Q_PROPERTY(bool validateNameFilters READ validateNameFilters WRITE setValidateNameFilters)
+	//! Specifies whether the validator only accepts files whose content matches the mime type filters
+	Q_PROPERTY(bool validateMimeTypes READ validateMimeTypes WRITE setValidateMimeTypes)
+	//! Specifies whether entered paths are validated in the background instead of the GUI thread
+	Q_PROPERTY(bool asyncValidation READ asyncValidation WRITE setAsyncValidation)
+	//! Specifies which model provides the entries for the completer
+	Q_PROPERTY(CompleterBackend completerBackend READ completerBackend WRITE setCompleterBackend)
+	//! Specifies how the completer matches the entered text against the entries
+	Q_PROPERTY(CompletionMode completionMode READ completionMode WRITE setCompletionMode)
+	//! Specifies which icons the completion popup shows for its entries
+	Q_PROPERTY(CompleterIcons completerIcons READ completerIcons WRITE setCompleterIcons)
+	//! Holds the maximum number of entries shown by the fuzzy completion
+	Q_PROPERTY(int fuzzyCompletionLimit READ fuzzyCompletionLimit WRITE setFuzzyCompletionLimit)
+	//! Holds the time in milliseconds to wait after a keystroke before the completer loads directories
+	Q_PROPERTY(int completionDelay READ completionDelay WRITE setCompletionDelay)
+	//! Holds the number of subdirectories the completer lists in advance
+	Q_PROPERTY(int completionPrefetch READ completionPrefetch WRITE setCompletionPrefetch)
+	//! Holds the state of the validation of the currently entered text
+	Q_PROPERTY(ValidationState validationState READ validationState NOTIFY validationStateChanged)
+	//! Holds the character that separates the paths in the QPathEdit::ExistingFiles mode
+	Q_PROPERTY(QChar pathSeparator READ pathSeparator WRITE setPathSeparator)
+	//! Specifies whether the accepted path is watched for being removed or replaced
+	Q_PROPERTY(bool watchPath READ watchPath WRITE setWatchPath)
 
 public:
 	//! Descibes various styles that the edit can take
@@ -68,16 +104,49 @@ public:
 	enum PathMode {
 		ExistingFile,//!< A single, existings file. This is basically "Open file"
 		ExistingFolder,//!< A single, existing directory. This is basically "Open Folder"
-		AnyFile//!< A single, valid file, no matter if exisiting or not (the directory, however, must exist). This is basically "Save File"
+		AnyFile,//!< A single, valid file, no matter if exisiting or not (the directory, however, must exist). This is basically "Save File"
+		ExistingFiles//!< Any number of existing files, separated by QPathEdit::pathSeparator. This is basically "Open files"
 	};
 	Q_ENUM(PathMode)
 
+	//! Describes the result of the validation of the entered text
+	enum ValidationState {
+		Valid,//!< The entered text is a valid path
+		Invalid,//!< The entered text is not a valid path
+		Pending,//!< The entered text is currently beeing validated in the background
+		Unverified//!< The entered text could not be validated, because it's filesystem did not respond in time
+	};
+	Q_ENUM(ValidationState)
+
+	//! Describes the models that can be used to provide the completers entries
+	enum CompleterBackend {
+		FileSystemBackend,//!< A QFileSystemModel, shared by all edits
+		DirectoryListBackend//!< A lightweight list of the directory currently typed into, loaded in the background
+	};
+	Q_ENUM(CompleterBackend)
+
+	//! Describes how the completer finds entries for the entered text
+	enum CompletionMode {
+		PrefixCompletion,//!< Only entries that start with the entered name are shown
+		FuzzyCompletion//!< All entries that contain the characters of the entered name in order are shown, best matches first
+	};
+	Q_ENUM(CompletionMode)
+
+	//! Describes the icons shown next to the entries of the completion popup
+	enum CompleterIcons {
+		NoIcons,//!< No icons are shown
+		TypeIcons,//!< A file, folder or link icon, all taken from one cached set
+		FileIcons//!< The real icons of the entries, resolved in the background for the visible rows only
+	};
+	Q_ENUM(CompleterIcons)
+
 	//! Constructs a new QPathEdit widget. The mode will be QPathEdit::ExistingFile
 	explicit QPathEdit(QWidget *parent = nullptr, Style style = SeperatedButton);
 	//! Constructs a new QPathEdit widget
 	explicit QPathEdit(PathMode pathMode, QWidget *parent = nullptr, Style style = SeperatedButton);
 	//! Constructs a new QPathEdit widget with the given default directory
-	explicit QPathEdit(PathMode pathMode, QString defaultDirectory, QWidget *parent = nullptr, Style style = SeperatedButton);
+	explicit QPathEdit(PathMode pathMode, const QString &defaultDirectory, QWidget *parent = nullptr, Style style = SeperatedButton);
+	~QPathEdit();
 
 	//! READ-ACCESSOR for QPathEdit::pathMode
 	PathMode pathMode() const;
@@ -109,6 +178,38 @@ public:
 	Style style() const;
 	//! READ-ACCESSOR for QPathEdit::dialogButtonIcon
 	QIcon dialogButtonIcon() const;
+	//! READ-ACCESSOR for QPathEdit::validateNameFilters
+	bool validateNameFilters() const;
+	//! READ-ACCESSOR for QPathEdit::validateMimeTypes
+	bool validateMimeTypes() const;
+	//! READ-ACCESSOR for QPathEdit::asyncValidation
+	bool asyncValidation() const;
+	//! READ-ACCESSOR for QPathEdit::validationState
+	ValidationState validationState() const;
+	//! READ-ACCESSOR for QPathEdit::completerBackend
+	CompleterBackend completerBackend() const;
+	//! READ-ACCESSOR for QPathEdit::completionMode
+	CompletionMode completionMode() const;
+	//! READ-ACCESSOR for QPathEdit::completerIcons
+	CompleterIcons completerIcons() const;
+	//! READ-ACCESSOR for QPathEdit::fuzzyCompletionLimit
+	int fuzzyCompletionLimit() const;
+	//! READ-ACCESSOR for QPathEdit::completionDelay
+	int completionDelay() const;
+	//! READ-ACCESSOR for QPathEdit::completionPrefetch
+	int completionPrefetch() const;
+	//! READ-ACCESSOR for QPathEdit::pathSeparator
+	QChar pathSeparator() const;
+	//! READ-ACCESSOR for QPathEdit::watchPath
+	bool watchPath() const;
+	//! Returns the currently entered, valid paths as a list
+	QStringList paths() const;
+	//! Returns the currently entered paths as a list, which might not be valid
+	QStringList editPaths() const;
+	//! Returns the validation state of each of the QPathEdit::editPaths
+	QVector<ValidationState> pathValidationStates() const;
+	//! Returns the filesystem paths are validated and completed against
+	QSharedPointer<QPathFileSystemProvider> fileSystemProvider() const;
 
 	//! WRITE-ACCESSOR for QPathEdit::pathMode
 	void setPathMode(PathMode pathMode);
@@ -117,17 +218,17 @@ public:
 	//! WRITE-ACCESSOR for QPathEdit::allowEmptyPath
 	void setAllowEmptyPath(bool allowEmptyPath);
 	//! WRITE-ACCESSOR for QPathEdit::defaultDirectory
-	void setDefaultDirectory(QString defaultDirectory);
+	void setDefaultDirectory(const QString &defaultDirectory);
 	//! WRITE-ACCESSOR for QPathEdit::path
-	bool setPath(QString path, bool allowInvalid = false);
+	bool setPath(const QString &path, bool allowInvalid = false);
 	//! RESET-ACCESSOR for QPathEdit::path
 	void clear();
 	//! WRITE-ACCESSOR for QPathEdit::placeholder
-	void setPlaceholder(QString placeholder);
+	void setPlaceholder(const QString &placeholder);
 	//! WRITE-ACCESSOR for QPathEdit::nameFilters
-	void setNameFilters(QStringList nameFilters);
+	void setNameFilters(const QStringList &nameFilters);
 	//! WRITE-ACCESSOR for QPathEdit::mimeTypeFilters
-	void setMimeTypeFilters(QStringList mimeTypeFilters);
+	void setMimeTypeFilters(const QStringList &mimeTypeFilters);
 	//! WRITE-ACCESSOR for QPathEdit::editable
 	void setEditable(bool editable);
 	//! WRITE-ACCESSOR for QPathEdit::useCompleter
@@ -138,6 +239,50 @@ public:
 	void setDialogButtonIcon(const QIcon &icon);
 	//! RESET-ACCESSOR for QPathEdit::dialogButtonIcon
 	void resetDialogButtonIcon();
+	//! WRITE-ACCESSOR for QPathEdit::validateNameFilters
+	void setValidateNameFilters(bool validateNameFilters);
+	//! WRITE-ACCESSOR for QPathEdit::validateMimeTypes
+	void setValidateMimeTypes(bool validateMimeTypes);
+	//! WRITE-ACCESSOR for QPathEdit::asyncValidation
+	void setAsyncValidation(bool asyncValidation);
+	//! WRITE-ACCESSOR for QPathEdit::completerBackend
+	void setCompleterBackend(CompleterBackend completerBackend);
+	//! WRITE-ACCESSOR for QPathEdit::completionMode
+	void setCompletionMode(CompletionMode completionMode);
+	//! WRITE-ACCESSOR for QPathEdit::completerIcons
+	void setCompleterIcons(CompleterIcons completerIcons);
+	//! WRITE-ACCESSOR for QPathEdit::fuzzyCompletionLimit
+	void setFuzzyCompletionLimit(int fuzzyCompletionLimit);
+	//! WRITE-ACCESSOR for QPathEdit::completionDelay
+	void setCompletionDelay(int completionDelay);
+	//! WRITE-ACCESSOR for QPathEdit::completionPrefetch
+	void setCompletionPrefetch(int completionPrefetch);
+	//! WRITE-ACCESSOR for QPathEdit::pathSeparator
+	void setPathSeparator(QChar pathSeparator);
+	//! WRITE-ACCESSOR for QPathEdit::watchPath
+	void setWatchPath(bool watchPath);
+	//! Sets the given paths, joined by the QPathEdit::pathSeparator
+	bool setPaths(const QStringList &paths, bool allowInvalid = false);
+	//! Sets the filesystem paths are validated and completed against
+	void setFileSystemProvider(const QSharedPointer<QPathFileSystemProvider> &provider);
+
+	//! Returns the time in milliseconds cached stat results stay valid
+	static int statCacheTimeout();
+	//! Sets the time in milliseconds cached stat results stay valid
+	static void setStatCacheTimeout(int msecs);
+	//! Returns the maximum number of paths kept in the stat cache
+	static int statCacheSize();
+	//! Sets the maximum number of paths kept in the stat cache
+	static void setStatCacheSize(int size);
+
+	//! Returns the performance statistics of this edit
+	QPathEditStatistics statistics() const;
+	//! Resets the performance statistics of this edit
+	void resetStatistics();
+	//! Returns the performance statistics of all edits together
+	static QPathEditStatistics globalStatistics();
+	//! Resets the performance statistics of all edits together
+	static void resetGlobalStatistics();
 
 public slots:
 	//! Shows the QFileDialog so the user can select a path
@@ -145,41 +290,119 @@ public slots:
 
 signals:
 	//! NOTIFY-ACCESSOR for QPathEdit::path
-	void pathChanged(QString path);
+	void pathChanged(const QString &path);
 	//! NOTIFY-ACCESSOR for QPathEdit::editPath
-	void editPathChanged(QString path);
+	void editPathChanged(const QString &path);
 	//! NOTIFY-ACCESSOR for QPathEdit::acceptableInput
 	void acceptableInputChanged(bool acceptableInput);
+	//! NOTIFY-ACCESSOR for QPathEdit::validationState
+	void validationStateChanged(ValidationState validationState);
+	//! Is emitted with the validation state of each entered path in the QPathEdit::ExistingFiles mode
+	void pathsValidated(const QVector<QPathEdit::ValidationState> &states);
+	//! Is emitted if the entry at an accepted path was removed, created or changed its kind, while QPathEdit::watchPath is enabled
+	void watchedPathChanged(const QString &path);
 
 private slots:
 	void updateValidInfo(const QString & path = QString());
 	void editTextUpdate();
 
-	void dialogFileSelected(const QString & file);
+	void dialogFilesSelected(const QStringList &files);
+	void dialogFinished();
+	void initCompleter();
+	void loadCompletionDirectory();
+	void completionDirectoryLoaded(const QString &dirPath);
+	void asyncValidated(const QString &path, QPathValidation::State state, const QVector<QPathValidation::State> &states);
+	void updatePathWatch();
+	void checkWatchedPaths();
 
 private:
 	QLineEdit *edit;
 	QCompleter *pathCompleter;
-	QFileSystemModel *completerModel;
+	CompleterFilterModel *completerModel;
+	DirectoryListModel *listModel;
+	QTimer *completionTimer;
+	int completionInterval;
+	QString completionDir;
 	PathValidator *pathValidator;
 	QFileDialog *dialog;
+	bool dialogFileSelected;
+	QSharedPointer<PerformanceCounters> perfCounters;
+	QElapsedTimer loadTimer;
 
 	QString currentValidPath;
 	bool wasPathValid;
+	ValidationState valState;
+	QVector<ValidationState> entryStates;
+	bool asyncValidate;
+	bool commitPending;
 
 	Style uiStyle;
 	PathMode mode;
 	QString defaultDir;
 	bool allowEmpty;
+	QFileDialog::Options dlgOptions;
+	QStringList nameFilterList;
+	QStringList mimeFilterList;
+	bool mimeFiltersActive;
+	QSharedPointer<const NameFilterMatcher> filterMatcher;
+	bool validateFilters;
+	bool validateMimes;
+	QHash<QString, bool> mimeVerdicts;
+	int mimeGeneration;
+	int setPathGeneration;
+	bool completerEnabled;
+	CompleterBackend completerBackendType;
+	CompletionMode completionModeType;
+	CompleterIcons iconMode;
+	int fuzzyLimit;
+	int prefetchCount;
+	QChar separator;
+	QSharedPointer<QPathFileSystemProvider> fsProvider;
+	bool dragActive;
+	bool dragAccepted;
+	QStringList dragPaths;
+	int dragGeneration;
+	bool watchEnabled;
+	QTimer *watchTimer;
+	QSharedPointer<QPathFileSystemProvider> watchProvider;
+	QMetaObject::Connection watchConnection;
+	QStringList watchedPaths;
+	QVector<QPathFileSystemProvider::EntryType> watchedTypes;
+	QStringList watchedDirs;
 
 	QToolButton *toolButton;
 	QAction *dialogAction;
 	bool hasCustomIcon;
 
-	QStringList modelFilters(const QStringList &normalFilters);
+	void validateText(const QString &text);
+	const QSharedPointer<PerformanceCounters> &localCounters();
+	void setValidationState(ValidationState state);
+	void setEntryStates(const QVector<QPathValidation::State> &states);
+	void finishValidation(const QString &text, QPathValidation::State state);
+	void finishValidation(const QString &text, QVector<QPathValidation::State> states);
+	bool mimeChecksActive() const;
+	ValidationState mimeState(const QString &text) const;
+	void setPathWhenMatching(const QString &path);
+	void checkMimeTypes(const QString &text, const QStringList &paths, const QVector<QPathValidation::State> &states);
+	void resetMimeChecks();
+	QString joinPaths(const QStringList &paths) const;
+	QString completionEntry(int *entryStart = nullptr) const;
+	bool handlesDrop(const QMimeData *mimeData) const;
+	QStringList acceptedDropPaths(const QMimeData *mimeData) const;
+	void checkDragPaths();
+	void finishDrag();
+	void initDialog();
+	void releaseDialog();
+	void initToolButton();
+	void updateDialogMode();
+	void updateCompleterFilters();
+	void resetCompleter();
+	void updateFilterMatcher();
+	void showCompletion();
 	QIcon getDefaultIcon();
 
 	bool eventFilter(QObject *watched, QEvent *event) override;
+	void changeEvent(QEvent *event) override;
 };
 
 #endif // QPATHEDIT_H
@@ -0,0 +1,279 @@
+#ifndef QPATHEDIT_P_H
+#define QPATHEDIT_P_H
+
+#include "qpathedit.h"
+#include "qpathvalidation_p.h"
+
+#include <QAbstractListModel>
+#include <QAtomicInt>
+#include <QCache>
+#include <QCompleter>
+#include <QElapsedTimer>
+#include <QFileIconProvider>
+#include <QFileSystemModel>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSortFilterProxyModel>
+#include <QValidator>
+#include <QVector>
+
+class PathValidator : public QValidator
+{
+	Q_OBJECT
+
+public:
+	PathValidator(QObject *parent);
+	void setMode(QPathEdit::PathMode mode);
+	void setAllowEmpty(bool allow);
+	void setFilterMatcher(const NameFilterMatcherPtr &matcher);
+	void setCounters(const PerformanceCountersPtr &counters);
+	void setSeparator(QChar separator);
+	void setFileSystemProvider(const QSharedPointer<QPathFileSystemProvider> &provider);
+	State validate(QString &text, int &) const override;
+	QPathValidation::State validateState(const QString &text) const;
+	QVector<QPathValidation::State> validateEntries(const QString &text) const;
+	QPathValidation::State combineStates(const QVector<QPathValidation::State> &states) const;
+
+	void validateAsync(const QString &text);
+	void cancelAsync();
+
+signals:
+	void asyncValidated(const QString &text, QPathValidation::State state, const QVector<QPathValidation::State> &entryStates);
+
+private:
+	QPathEdit::PathMode mode;
+	bool allowEmpty;
+	NameFilterMatcherPtr filterMatcher;
+	PerformanceCountersPtr perfCounters;
+	QChar separator;
+	QSharedPointer<QPathFileSystemProvider> fsProvider;
+	QSharedPointer<PrefixMemo> prefixMemo;
+	QSharedPointer<QAtomicInt> asyncGeneration;
+	mutable QHash<QString, QPathValidation::State> entryMemo;
+	mutable quint64 entryEpoch;
+	mutable QElapsedTimer entryTimer;
+};
+
+class PathCompleter : public QCompleter
+{
+public:
+	PathCompleter(QObject *parent);
+
+	QStringList splitPath(const QString &path) const override;
+	QString pathFromIndex(const QModelIndex &index) const override;
+};
+
+class NoIconProvider : public QFileIconProvider
+{
+public:
+	QIcon icon(IconType type) const override;
+	QIcon icon(const QFileInfo &info) const override;
+};
+
+class CompleterFilterModel : public QSortFilterProxyModel
+{
+public:
+	CompleterFilterModel(QPathEdit::CompleterIcons iconMode, QObject *parent);
+	~CompleterFilterModel();
+
+	QFileSystemModel *fileSystemModel() const;
+
+	void setMode(QPathEdit::PathMode mode);
+	void setFilterMatcher(const NameFilterMatcherPtr &matcher);
+	void setIconMode(QPathEdit::CompleterIcons iconMode);
+
+	QVariant data(const QModelIndex &index, int role) const override;
+
+protected:
+	bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+	QSharedPointer<QFileSystemModel> fsModel;
+	QPathEdit::PathMode mode;
+	NameFilterMatcherPtr filterMatcher;
+	QPathEdit::CompleterIcons iconMode;
+
+	static QSharedPointer<QFileSystemModel> sharedFileSystemModel(bool withIcons);
+};
+
+class FileDialogPool
+{
+public:
+	static QFileDialog *checkOut(QWidget *owner);
+	static void checkIn(QFileDialog *dialog, bool fileSelected);
+
+private:
+	static QByteArray &initialState();
+	static QList<QPointer<QFileDialog>> &idleDialogs();
+};
+
+struct DefaultIconKey
+{
+	int style;
+	QString text;
+	QString font;
+	QRgb color;
+	qreal devicePixelRatio;
+
+	bool operator==(const DefaultIconKey &other) const;
+};
+
+uint qHash(const DefaultIconKey &key, uint seed = 0);
+
+struct DirectoryEntry
+{
+	enum TypeFlag : quint8 {
+		File = 0x01,
+		Dir = 0x02,
+		SymLink = 0x04
+	};
+
+	QString name;
+	quint8 type;
+};
+
+struct DirectoryListing
+{
+	QString dirPath;
+	QVector<DirectoryEntry> entries;
+	QVector<quint64> charMasks;
+};
+
+struct DirectoryChunk
+{
+	QSharedPointer<const QVector<DirectoryEntry>> entries;
+	QSharedPointer<const DirectoryListing> listing;
+};
+
+class DirectoryLister : public QObject
+{
+	Q_OBJECT
+
+public:
+	typedef QSharedPointer<const DirectoryListing> Listing;
+
+	DirectoryLister(const QSharedPointer<QPathFileSystemProvider> &provider);
+	~DirectoryLister();
+
+	static QSharedPointer<DirectoryLister> instance(const QSharedPointer<QPathFileSystemProvider> &provider);
+
+	Listing cachedListing(const QString &dirPath);
+	void requestListing(const QString &dirPath, bool prefetch = false);
+	void markUsed(const QString &dirPath);
+	void prefetch(const Listing &listing, int count);
+
+signals:
+	void listingReady(const QString &dirPath, const DirectoryLister::Listing &listing);
+	void entriesRead(const QString &dirPath, const QVector<DirectoryEntry> &entries);
+
+private:
+	struct CacheEntry {
+		Listing listing;
+		qint64 timestamp;
+	};
+
+	struct Usage {
+		quint32 count;
+		qint64 lastUse;
+	};
+
+	QSharedPointer<QPathFileSystemProvider> fsProvider;
+	QElapsedTimer clock;
+	QHash<QString, CacheEntry> cache;
+	QStringList cacheOrder;
+	int cachedEntries;
+	QSet<QString> pending;
+	QHash<QString, Usage> usage;
+
+	void removeListing(const QString &dirPath);
+	static void readDirectory(QFutureInterface<DirectoryChunk> future, const QString &dirPath, const QSharedPointer<QPathFileSystemProvider> &provider);
+};
+
+class EntryIconLoader : public QObject
+{
+	Q_OBJECT
+
+public:
+	EntryIconLoader(QObject *parent);
+
+	QIcon icon(const QString &path, quint8 type);
+	void clearPending();
+
+signals:
+	void iconsLoaded();
+
+private slots:
+	void loadPending();
+	void loadFinished();
+
+private:
+	QSet<QString> pending;
+	QTimer *loadTimer;
+	QFutureWatcher<QHash<QString, QIcon>> *loadWatcher;
+
+	static QCache<QString, QIcon> &iconCache();
+	static QHash<QString, QIcon> loadIcons(const QStringList &paths);
+};
+
+class DirectoryListModel : public QAbstractListModel
+{
+	Q_OBJECT
+
+public:
+	DirectoryListModel(const QSharedPointer<QPathFileSystemProvider> &provider, QObject *parent);
+
+	QString directory() const;
+	void setDirectory(const QString &dirPath, const QString &completionPrefix);
+
+	void setMode(QPathEdit::PathMode mode);
+	void setFilterMatcher(const NameFilterMatcherPtr &matcher);
+
+	bool hasListing() const;
+	void setFuzzyCompletion(bool enabled, int limit);
+	void setPrefetchCount(int count);
+	void setFuzzyPattern(const QString &pattern);
+	void setNamePrefix(const QString &namePrefix);
+	void setIconMode(QPathEdit::CompleterIcons iconMode);
+
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role) const override;
+
+signals:
+	void directoryLoaded(const QString &dirPath);
+
+private slots:
+	void listingReady(const QString &dirPath, const DirectoryLister::Listing &listing);
+	void entriesRead(const QString &dirPath, const QVector<DirectoryEntry> &entries);
+	void iconsLoaded();
+
+private:
+	QSharedPointer<DirectoryLister> lister;
+	bool localEntries;
+	QString dirPath;
+	QString prefix;
+	DirectoryLister::Listing listing;
+	QVector<int> rows;
+	bool allRows;
+	QVector<DirectoryEntry> streamed;
+	QString namePrefix;
+	QPathEdit::PathMode mode;
+	NameFilterMatcherPtr filterMatcher;
+	bool fuzzy;
+	int fuzzyLimit;
+	QString fuzzyPattern;
+	int prefetchCount;
+	QPathEdit::CompleterIcons iconMode;
+	EntryIconLoader *iconLoader;
+
+	void updateRows();
+	void updateFuzzyRows();
+	QVector<DirectoryEntry> streamMatches(const QVector<DirectoryEntry> &entries) const;
+	bool acceptsEntry(const DirectoryEntry &entry) const;
+	QVariant entryIcon(const DirectoryEntry &entry) const;
+};
+
+#endif // QPATHEDIT_P_H
@@ -0,0 +1,289 @@
+#include "qpatheditdelegate.h"
+#include "qpathedit_p.h"
+
+#include <QAbstractItemView>
+#include <QColor>
+#include <QEvent>
+#include <QFutureWatcher>
+#include <QLineEdit>
+#include <QPalette>
+#include <QStandardPaths>
+#include <QTimer>
+
+QPathEditDelegate::QPathEditDelegate(QObject *parent) :
+	QPathEditDelegate(QPathEdit::ExistingFile, parent)
+{}
+
+QPathEditDelegate::QPathEditDelegate(QPathEdit::PathMode pathMode, QObject *parent) :
+	QStyledItemDelegate(parent),
+	mode(pathMode),
+	defaultDir(QStandardPaths::writableLocation(QStandardPaths::HomeLocation)),
+	nameFilterList(),
+	validateFilters(false),
+	style(QPathEdit::JoinedButton),
+	paintValidity(true),
+	validation(static_cast<QPathValidation::Mode>(pathMode)),
+	fsProvider(),
+	//the listings of the completer are kept between two edits, as all cells share them
+	lister(DirectoryLister::instance(fsProvider)),
+	validateTimer(new QTimer(this)),
+	clock(),
+	generation(0),
+	stateCache(),
+	pendingPaths(),
+	queuedPaths(),
+	views()
+{
+	clock.start();
+	//the cells of one paint event are validated together
+	validateTimer->setSingleShot(true);
+	validateTimer->setInterval(0);
+	connect(validateTimer, &QTimer::timeout, this, &QPathEditDelegate::validateQueued);
+}
+
+QPathEditDelegate::~QPathEditDelegate() {}
+
+QPathEdit::PathMode QPathEditDelegate::pathMode() const
+{
+	return mode;
+}
+
+bool QPathEditDelegate::isEmptyPathAllowed() const
+{
+	return validation.isEmptyPathAllowed();
+}
+
+QString QPathEditDelegate::defaultDirectory() const
+{
+	return defaultDir;
+}
+
+QStringList QPathEditDelegate::nameFilters() const
+{
+	return nameFilterList;
+}
+
+bool QPathEditDelegate::validateNameFilters() const
+{
+	return validateFilters;
+}
+
+QPathEdit::Style QPathEditDelegate::editorStyle() const
+{
+	return style;
+}
+
+bool QPathEditDelegate::showValidity() const
+{
+	return paintValidity;
+}
+
+QSharedPointer<QPathFileSystemProvider> QPathEditDelegate::fileSystemProvider() const
+{
+	return fsProvider ? fsProvider : QPathFileSystemProvider::local();
+}
+
+void QPathEditDelegate::setPathMode(QPathEdit::PathMode pathMode)
+{
+	mode = pathMode;
+	validation.setMode(static_cast<QPathValidation::Mode>(pathMode));
+	resetStates();
+}
+
+void QPathEditDelegate::setAllowEmptyPath(bool allowEmptyPath)
+{
+	validation.setAllowEmptyPath(allowEmptyPath);
+	resetStates();
+}
+
+void QPathEditDelegate::setDefaultDirectory(const QString &defaultDirectory)
+{
+	defaultDir = defaultDirectory;
+}
+
+void QPathEditDelegate::setNameFilters(const QStringList &nameFilters)
+{
+	nameFilterList = nameFilters;
+	if(validateFilters) {
+		validation.setNameFilters(nameFilters);
+		resetStates();
+	}
+}
+
+void QPathEditDelegate::setValidateNameFilters(bool validateNameFilters)
+{
+	validateFilters = validateNameFilters;
+	validation.setNameFilters(validateNameFilters ? nameFilterList : QStringList());
+	resetStates();
+}
+
+void QPathEditDelegate::setEditorStyle(QPathEdit::Style editorStyle)
+{
+	style = editorStyle;
+}
+
+void QPathEditDelegate::setShowValidity(bool showValidity)
+{
+	paintValidity = showValidity;
+}
+
+void QPathEditDelegate::setFileSystemProvider(const QSharedPointer<QPathFileSystemProvider> &provider)
+{
+	//the default provider is not stored, just like in the edit, so both find the same lister
+	QSharedPointer<QPathFileSystemProvider> newProvider;
+	if(provider != QPathFileSystemProvider::local())
+		newProvider = provider;
+	if(fsProvider == newProvider)
+		return;
+	fsProvider = newProvider;
+	validation.setFileSystemProvider(fsProvider);
+	lister = DirectoryLister::instance(fsProvider);
+	resetStates();
+}
+
+QWidget *QPathEditDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &, const QModelIndex &) const
+{
+	QPathEdit *editor = new QPathEdit(mode, defaultDir, parent, style);
+	editor->setAllowEmptyPath(validation.isEmptyPathAllowed());
+	editor->setNameFilters(nameFilterList);
+	editor->setValidateNameFilters(validateFilters);
+	editor->setFileSystemProvider(fsProvider);
+	//the list backend uses the listings this delegate keeps alive
+	editor->setCompleterBackend(QPathEdit::DirectoryListBackend);
+	editor->setAutoFillBackground(true);
+
+	//the focus is on the line edit inside, so the view would never learn that the editor lost it
+	QLineEdit *lineEdit = editor->findChild<QLineEdit*>(QString(), Qt::FindDirectChildrenOnly);
+	if(lineEdit)
+		lineEdit->installEventFilter(const_cast<QPathEditDelegate*>(this));
+	return editor;
+}
+
+void QPathEditDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
+{
+	QPathEdit *pathEdit = qobject_cast<QPathEdit*>(editor);
+	if(pathEdit)
+		pathEdit->setPath(index.data(Qt::EditRole).toString(), true);
+	else
+		QStyledItemDelegate::setEditorData(editor, index);
+}
+
+void QPathEditDelegate::setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const
+{
+	QPathEdit *pathEdit = qobject_cast<QPathEdit*>(editor);
+	if(!pathEdit)
+		QStyledItemDelegate::setModelData(editor, model, index);
+	else if(pathEdit->hasAcceptableInput())
+		model->setData(index, pathEdit->path(), Qt::EditRole);
+}
+
+void QPathEditDelegate::initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const
+{
+	QStyledItemDelegate::initStyleOption(option, index);
+	if(!paintValidity)
+		return;
+
+	//painting never touches the filesystem, the states of the visible cells are checked in the background
+	switch(cellState(index.data(Qt::EditRole).toString(), option->widget)) {
+	case QPathEdit::Invalid:
+		option->palette.setColor(QPalette::Text, QColor(QStringLiteral("#B40404")));
+		break;
+	case QPathEdit::Unverified:
+		option->palette.setColor(QPalette::Text, QColor(QStringLiteral("#B45F04")));
+		break;
+	default:
+		break;
+	}
+}
+
+bool QPathEditDelegate::eventFilter(QObject *object, QEvent *event)
+{
+	//focus changes of the line edit are handled as if the editor itself had them
+	if(event->type() == QEvent::FocusOut) {
+		QLineEdit *lineEdit = qobject_cast<QLineEdit*>(object);
+		if(lineEdit && qobject_cast<QPathEdit*>(lineEdit->parentWidget()))
+			return QStyledItemDelegate::eventFilter(lineEdit->parentWidget(), event);
+	}
+	return QStyledItemDelegate::eventFilter(object, event);
+}
+
+QPathEdit::ValidationState QPathEditDelegate::cellState(const QString &path, const QWidget *view) const
+{
+	auto it = stateCache.constFind(path);
+	const bool known = it != stateCache.constEnd();
+	//expired states are checked again, but still painted until the new one is known
+	const bool expired = known && clock.elapsed() - it->timestamp > QPathEdit::statCacheTimeout();
+	if((!known || expired) && !pendingPaths.contains(path)) {
+		pendingPaths.insert(path);
+		queuedPaths.append(path);
+		if(view && !views.contains(const_cast<QWidget*>(view)))
+			views.append(const_cast<QWidget*>(view));
+		validateTimer->start();
+	}
+
+	//like the edit, pending cells keep the normal color, so scrolling does not flicker
+	if(!known)
+		return QPathEdit::Pending;
+	switch(it->state) {
+	case QPathValidation::Acceptable:
+		return QPathEdit::Valid;
+	case QPathValidation::Unverified:
+		return QPathEdit::Unverified;
+	default:
+		return QPathEdit::Invalid;
+	}
+}
+
+void QPathEditDelegate::validateQueued()
+{
+	if(queuedPaths.isEmpty())
+		return;
+
+	//a table with many different paths would otherwise keep all of them
+	if(stateCache.size() > 4096)
+		stateCache.clear();
+
+	const QStringList paths = queuedPaths;
+	queuedPaths.clear();
+	const int requestGeneration = generation;
+	typedef QFutureWatcher<QPathValidation::State> StateWatcher;
+	StateWatcher *watcher = new StateWatcher(this);
+	connect(watcher, &StateWatcher::resultsReadyAt, this, [this, watcher, paths, requestGeneration](int begin, int end){
+		//results for old settings are dropped, the cells were queued again by the reset
+		if(requestGeneration != generation)
+			return;
+		for(int i = begin; i < end; ++i) {
+			pendingPaths.remove(paths[i]);
+			stateCache.insert(paths[i], CachedState {watcher->resultAt(i), clock.elapsed()});
+		}
+		updateViews();
+	});
+	connect(watcher, &StateWatcher::finished, watcher, &StateWatcher::deleteLater);
+	watcher->setFuture(validation.validateConcurrent(paths));
+}
+
+void QPathEditDelegate::updateViews()
+{
+	//only the visible cells are repainted, and those take their states from the cache
+	for(auto it = views.begin(); it != views.end();) {
+		if(!*it) {
+			it = views.erase(it);
+			continue;
+		}
+		QAbstractItemView *itemView = qobject_cast<QAbstractItemView*>(it->data());
+		if(itemView)
+			itemView->viewport()->update();
+		else
+			(*it)->update();
+		++it;
+	}
+}
+
+void QPathEditDelegate::resetStates()
+{
+	++generation;
+	stateCache.clear();
+	pendingPaths.clear();
+	queuedPaths.clear();
+	updateViews();
+}
@@ -0,0 +1,116 @@
+#ifndef QPATHEDITDELEGATE_H
+#define QPATHEDITDELEGATE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QStyledItemDelegate>
+#include "qpathedit.h"
+#include "qpathvalidation.h"
+
+class DirectoryLister;
+class QTimer;
+
+//! An item delegate that shows paths in item views and edits them with a QPathEdit
+class DESIGNER_PLUGIN_EXPORT QPathEditDelegate : public QStyledItemDelegate
+{
+	Q_OBJECT
+
+	//! Specifies the kind of path to be entered
+	Q_PROPERTY(QPathEdit::PathMode pathMode READ pathMode WRITE setPathMode)
+	//! Specifies whether an empty path is allowed or not
+	Q_PROPERTY(bool allowEmptyPath READ isEmptyPathAllowed WRITE setAllowEmptyPath)
+	//! Holds the default directory for the QFileDialog of the editor
+	Q_PROPERTY(QString defaultDirectory READ defaultDirectory WRITE setDefaultDirectory)
+	//! Holds name filters for the dialog and the completer of the editor
+	Q_PROPERTY(QStringList nameFilters READ nameFilters WRITE setNameFilters)
+	//! Specifies whether only files that match the name filters are valid
+	Q_PROPERTY(bool validateNameFilters READ validateNameFilters WRITE setValidateNameFilters)
+	//! Defines the appereance of the editor
+	Q_PROPERTY(QPathEdit::Style editorStyle READ editorStyle WRITE setEditorStyle)
+	//! Specifies whether invalid paths are painted in a different color
+	Q_PROPERTY(bool showValidity READ showValidity WRITE setShowValidity)
+
+public:
+	//! Constructs a new delegate. The mode will be QPathEdit::ExistingFile
+	explicit QPathEditDelegate(QObject *parent = nullptr);
+	//! Constructs a new delegate for the given kind of path
+	explicit QPathEditDelegate(QPathEdit::PathMode pathMode, QObject *parent = nullptr);
+	~QPathEditDelegate();
+
+	//! READ-ACCESSOR for QPathEditDelegate::pathMode
+	QPathEdit::PathMode pathMode() const;
+	//! READ-ACCESSOR for QPathEditDelegate::allowEmptyPath
+	bool isEmptyPathAllowed() const;
+	//! READ-ACCESSOR for QPathEditDelegate::defaultDirectory
+	QString defaultDirectory() const;
+	//! READ-ACCESSOR for QPathEditDelegate::nameFilters
+	QStringList nameFilters() const;
+	//! READ-ACCESSOR for QPathEditDelegate::validateNameFilters
+	bool validateNameFilters() const;
+	//! READ-ACCESSOR for QPathEditDelegate::editorStyle
+	QPathEdit::Style editorStyle() const;
+	//! READ-ACCESSOR for QPathEditDelegate::showValidity
+	bool showValidity() const;
+	//! Returns the filesystem paths are validated and completed against
+	QSharedPointer<QPathFileSystemProvider> fileSystemProvider() const;
+
+	//! WRITE-ACCESSOR for QPathEditDelegate::pathMode
+	void setPathMode(QPathEdit::PathMode pathMode);
+	//! WRITE-ACCESSOR for QPathEditDelegate::allowEmptyPath
+	void setAllowEmptyPath(bool allowEmptyPath);
+	//! WRITE-ACCESSOR for QPathEditDelegate::defaultDirectory
+	void setDefaultDirectory(const QString &defaultDirectory);
+	//! WRITE-ACCESSOR for QPathEditDelegate::nameFilters
+	void setNameFilters(const QStringList &nameFilters);
+	//! WRITE-ACCESSOR for QPathEditDelegate::validateNameFilters
+	void setValidateNameFilters(bool validateNameFilters);
+	//! WRITE-ACCESSOR for QPathEditDelegate::editorStyle
+	void setEditorStyle(QPathEdit::Style editorStyle);
+	//! WRITE-ACCESSOR for QPathEditDelegate::showValidity
+	void setShowValidity(bool showValidity);
+	//! Sets the filesystem paths are validated and completed against
+	void setFileSystemProvider(const QSharedPointer<QPathFileSystemProvider> &provider);
+
+	QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+	void setEditorData(QWidget *editor, const QModelIndex &index) const override;
+	void setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const override;
+
+protected:
+	void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override;
+	bool eventFilter(QObject *object, QEvent *event) override;
+
+private:
+	struct CachedState {
+		QPathValidation::State state;
+		qint64 timestamp;
+	};
+
+	QPathEdit::PathMode mode;
+	QString defaultDir;
+	QStringList nameFilterList;
+	bool validateFilters;
+	QPathEdit::Style style;
+	bool paintValidity;
+	QPathValidation validation;
+	QSharedPointer<QPathFileSystemProvider> fsProvider;
+	QSharedPointer<DirectoryLister> lister;
+	QTimer *validateTimer;
+	QElapsedTimer clock;
+	int generation;
+	mutable QHash<QString, CachedState> stateCache;
+	mutable QSet<QString> pendingPaths;
+	mutable QStringList queuedPaths;
+	mutable QList<QPointer<QWidget>> views;
+
+	QPathEdit::ValidationState cellState(const QString &path, const QWidget *view) const;
+	void validateQueued();
+	void updateViews();
+	void resetStates();
+};
+
+#endif // QPATHEDITDELEGATE_H
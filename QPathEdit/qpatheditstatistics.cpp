@@ -0,0 +1,109 @@
+#include "qpatheditstatistics.h"
+#include "qpathvalidation_p.h"
+
+#include <algorithm>
+#include <limits>
+
+Q_GLOBAL_STATIC(PerformanceCounters, globalCounters)
+
+QPathEditStatistics::QPathEditStatistics()
+{
+	std::fill_n(counters, static_cast<int>(CounterCount), 0);
+	std::fill_n(totals, static_cast<int>(TimingCount), 0);
+	std::fill_n(&buckets[0][0], TimingCount * BucketCount, 0);
+}
+
+quint64 QPathEditStatistics::count(QPathEditStatistics::Counter counter) const
+{
+	return counters[counter];
+}
+
+quint64 QPathEditStatistics::timingCount(QPathEditStatistics::Timing timing) const
+{
+	quint64 sum = 0;
+	for(int i = 0; i < BucketCount; ++i)
+		sum += buckets[timing][i];
+	return sum;
+}
+
+quint64 QPathEditStatistics::totalTime(QPathEditStatistics::Timing timing) const
+{
+	return totals[timing];
+}
+
+QVector<quint64> QPathEditStatistics::histogram(QPathEditStatistics::Timing timing) const
+{
+	QVector<quint64> result(BucketCount);
+	std::copy_n(buckets[timing], static_cast<int>(BucketCount), result.begin());
+	return result;
+}
+
+quint64 QPathEditStatistics::bucketLimit(int bucket)
+{
+	//bucket 0 holds everything below 1us, every following one doubles the limit
+	if(bucket >= BucketCount - 1)
+		return std::numeric_limits<quint64>::max();
+	else
+		return Q_UINT64_C(1) << bucket;
+}
+
+//PRIVATE COUNTERS IMPLEMENTATION
+
+PerformanceCounters::PerformanceCounters() :
+	counters(),
+	totals(),
+	buckets()
+{}
+
+PerformanceCounters *PerformanceCounters::global()
+{
+	return globalCounters();
+}
+
+void PerformanceCounters::count(PerformanceCounters *local, QPathEditStatistics::Counter counter)
+{
+	global()->counters[counter].fetchAndAddRelaxed(1);
+	if(local)
+		local->counters[counter].fetchAndAddRelaxed(1);
+}
+
+void PerformanceCounters::time(PerformanceCounters *local, QPathEditStatistics::Timing timing, qint64 nsecs)
+{
+	quint64 usecs = static_cast<quint64>(qMax<qint64>(nsecs, 0) / 1000);
+	int bucket = 0;
+	while(bucket < QPathEditStatistics::BucketCount - 1 &&
+		  usecs >= QPathEditStatistics::bucketLimit(bucket))
+		++bucket;
+
+	PerformanceCounters *targets[] = {global(), local};
+	for(PerformanceCounters *target : targets) {
+		if(!target)
+			continue;
+		target->totals[timing].fetchAndAddRelaxed(usecs);
+		target->buckets[timing][bucket].fetchAndAddRelaxed(1);
+	}
+}
+
+QPathEditStatistics PerformanceCounters::snapshot() const
+{
+	QPathEditStatistics statistics;
+	for(int i = 0; i < QPathEditStatistics::CounterCount; ++i)
+		statistics.counters[i] = counters[i].load();
+	for(int i = 0; i < QPathEditStatistics::TimingCount; ++i) {
+		statistics.totals[i] = totals[i].load();
+		for(int j = 0; j < QPathEditStatistics::BucketCount; ++j)
+			statistics.buckets[i][j] = buckets[i][j].load();
+	}
+	return statistics;
+}
+
+void PerformanceCounters::reset()
+{
+	for(int i = 0; i < QPathEditStatistics::CounterCount; ++i)
+		counters[i].store(0);
+	for(int i = 0; i < QPathEditStatistics::TimingCount; ++i) {
+		totals[i].store(0);
+		for(int j = 0; j < QPathEditStatistics::BucketCount; ++j)
+			buckets[i][j].store(0);
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef QPATHEDITSTATISTICS_H
+#define QPATHEDITSTATISTICS_H
+
+#include <QtGlobal>
+#include <QVector>
+
+//! A snapshot of the performance counters and latency histograms of QPathEdit
+class QPathEditStatistics
+{
+public:
+	//! The events that are counted
+	enum Counter {
+		Validations,//!< Paths that have been validated
+		StatCalls,//!< Filesystem stats done, because the result was not cached
+		CacheHits,//!< Stat results that have been taken from the cache
+		DirectoryLoads,//!< Directories the completer has requested
+		Completions,//!< Completion popups that have been shown
+		DialogOpens,//!< File dialogs that have been opened
+		StatTimeouts,//!< Filesystem stats that missed their deadline or were skipped because of a slow mount
+		DirectoryPrefetches,//!< Directories the completer listed in advance. Only counted globally
+
+		CounterCount//!< The number of counters. Not a valid counter
+	};
+
+	//! The operations that are timed
+	enum Timing {
+		ValidationTime,//!< Validation of a single path
+		DirectoryLoadTime,//!< From requesting a directory until the completer has it
+		CompletionTime,//!< Showing or updating the completion popup
+		DialogOpenTime,//!< Preparing and opening the file dialog
+
+		TimingCount//!< The number of timings. Not a valid timing
+	};
+
+	//! The number of buckets of each latency histogram
+	static const int BucketCount = 24;
+
+	//! Creates empty statistics
+	QPathEditStatistics();
+
+	//! Returns how often the given event happened
+	quint64 count(Counter counter) const;
+	//! Returns how often the given operation was timed
+	quint64 timingCount(Timing timing) const;
+	//! Returns the summed up duration of the given operation, in microseconds
+	quint64 totalTime(Timing timing) const;
+	//! Returns the latency histogram of the given operation
+	QVector<quint64> histogram(Timing timing) const;
+
+	//! Returns the exclusive upper limit of a histogram bucket, in microseconds
+	static quint64 bucketLimit(int bucket);
+
+private:
+	friend class PerformanceCounters;
+
+	quint64 counters[CounterCount];
+	quint64 totals[TimingCount];
+	quint64 buckets[TimingCount][BucketCount];
+};
+
+#endif // QPATHEDITSTATISTICS_H
@@ -0,0 +1,224 @@
+#include "qpathfilesystemprovider.h"
+#include "qpathvalidation_p.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+
+QPathFileSystemProvider::QPathFileSystemProvider(QObject *parent) :
+	QObject(parent)
+{}
+
+void QPathFileSystemProvider::watch(const QString &) {}
+
+void QPathFileSystemProvider::unwatch(const QString &) {}
+
+QSharedPointer<QPathFileSystemProvider> QPathFileSystemProvider::local()
+{
+	static QSharedPointer<QPathFileSystemProvider> provider(new QPathLocalFileSystemProvider());
+	return provider;
+}
+
+//LOCAL PROVIDER IMPLEMENTATION
+
+QPathLocalFileSystemProvider::QPathLocalFileSystemProvider(QObject *parent) :
+	QPathFileSystemProvider(parent)
+{
+	//the changes must arrive in the main thread, even if the provider was created in a worker
+	if(!parent && QCoreApplication::instance())
+		moveToThread(QCoreApplication::instance()->thread());
+	//all local providers and the stat cache share one watcher, so each directory costs only one watch
+	connect(PathStatCache::instance(), &PathStatCache::directoryChanged,
+			this, &QPathLocalFileSystemProvider::directoryChanged);
+}
+
+QPathFileSystemProvider::EntryType QPathLocalFileSystemProvider::entryType(const QString &path) const
+{
+	PathStat pathStat = PathStatCache::instance()->stat(path);
+	if(!pathStat.verified)
+		return Unknown;
+	else if(pathStat.isDir)
+		return Directory;
+	else if(pathStat.exists)
+		return File;
+	else
+		return NoEntry;
+}
+
+QVector<QPathFileSystemProvider::Entry> QPathLocalFileSystemProvider::entries(const QString &dirPath) const
+{
+	QVector<Entry> result;
+	//the iterator fills the file infos from the directory entries, so no extra stat per entry is needed
+	QDirIterator iterator(dirPath, QDir::AllEntries | QDir::NoDotAndDotDot);
+	while(iterator.hasNext()) {
+		iterator.next();
+		QFileInfo info = iterator.fileInfo();
+		Entry entry;
+		entry.name = iterator.fileName();
+		entry.type = info.isDir() ? Directory : File;
+		entry.isSymLink = info.isSymLink();
+		result.append(entry);
+	}
+	return result;
+}
+
+void QPathLocalFileSystemProvider::watch(const QString &dirPath)
+{
+	PathStatCache::instance()->watch(dirPath);
+}
+
+void QPathLocalFileSystemProvider::unwatch(const QString &dirPath)
+{
+	PathStatCache::instance()->unwatch(dirPath);
+}
+
+//MEMORY PROVIDER IMPLEMENTATION
+
+QPathMemoryFileSystemProvider::QPathMemoryFileSystemProvider(QObject *parent) :
+	QPathFileSystemProvider(parent),
+	lock(),
+	directories()
+{}
+
+QPathFileSystemProvider::EntryType QPathMemoryFileSystemProvider::entryType(const QString &path) const
+{
+	const QString key = entryKey(path);
+	QReadLocker locker(&lock);
+	if(directories.contains(key))
+		return Directory;
+
+	const QString parent = parentKey(key);
+	auto it = directories.constFind(parent);
+	if(parent.isNull() || it == directories.constEnd())
+		return NoEntry;
+	return it->value(key.mid(key.lastIndexOf(QLatin1Char('/')) + 1), NoEntry);
+}
+
+QVector<QPathFileSystemProvider::Entry> QPathMemoryFileSystemProvider::entries(const QString &dirPath) const
+{
+	QVector<Entry> result;
+	const QString key = entryKey(dirPath);
+	QReadLocker locker(&lock);
+	auto dirIt = directories.constFind(key);
+	if(dirIt == directories.constEnd())
+		return result;
+
+	result.reserve(dirIt->size());
+	for(auto it = dirIt->constBegin(); it != dirIt->constEnd(); ++it)
+		result.append(Entry {it.key(), it.value(), false});
+	return result;
+}
+
+void QPathMemoryFileSystemProvider::addFile(const QString &path)
+{
+	QSet<QString> changedDirs;
+	{
+		QWriteLocker locker(&lock);
+		addEntry(entryKey(path), File, changedDirs);
+	}
+	emitChanges(changedDirs);
+}
+
+void QPathMemoryFileSystemProvider::addDirectory(const QString &dirPath)
+{
+	QSet<QString> changedDirs;
+	{
+		QWriteLocker locker(&lock);
+		addEntry(entryKey(dirPath), Directory, changedDirs);
+	}
+	emitChanges(changedDirs);
+}
+
+void QPathMemoryFileSystemProvider::remove(const QString &path)
+{
+	const QString key = entryKey(path);
+	QSet<QString> changedDirs;
+	{
+		QWriteLocker locker(&lock);
+		removeTree(key, changedDirs);
+		const QString parent = parentKey(key);
+		auto it = directories.find(parent);
+		if(!parent.isNull() && it != directories.end() &&
+		   it->remove(key.mid(key.lastIndexOf(QLatin1Char('/')) + 1)) > 0)
+			changedDirs.insert(parent);
+	}
+	emitChanges(changedDirs);
+}
+
+void QPathMemoryFileSystemProvider::clear()
+{
+	QSet<QString> changedDirs;
+	{
+		QWriteLocker locker(&lock);
+		changedDirs = directories.keys().toSet();
+		directories.clear();
+	}
+	emitChanges(changedDirs);
+}
+
+void QPathMemoryFileSystemProvider::addEntry(const QString &key, QPathFileSystemProvider::EntryType type, QSet<QString> &changedDirs)
+{
+	if(type == Directory) {
+		if(!directories.contains(key))
+			directories.insert(key, QMap<QString, EntryType>());
+	} else
+		removeTree(key, changedDirs);//a file replaces a directory of the same name
+
+	const QString parent = parentKey(key);
+	if(parent.isNull())
+		return;
+	if(!directories.contains(parent))
+		addEntry(parent, Directory, changedDirs);
+
+	QMap<QString, EntryType> &siblings = directories[parent];
+	const QString name = key.mid(key.lastIndexOf(QLatin1Char('/')) + 1);
+	if(siblings.value(name, NoEntry) != type) {
+		siblings.insert(name, type);
+		changedDirs.insert(parent);
+	}
+}
+
+void QPathMemoryFileSystemProvider::removeTree(const QString &key, QSet<QString> &changedDirs)
+{
+	auto it = directories.find(key);
+	if(it == directories.end())
+		return;
+
+	QStringList subDirs;
+	for(auto child = it->constBegin(); child != it->constEnd(); ++child) {
+		if(child.value() == Directory)
+			subDirs.append(key.endsWith(QLatin1Char('/')) ? key + child.key() : key + QLatin1Char('/') + child.key());
+	}
+	directories.erase(it);
+	changedDirs.insert(key);
+	foreach(const QString &subDir, subDirs)
+		removeTree(subDir, changedDirs);
+}
+
+void QPathMemoryFileSystemProvider::emitChanges(const QSet<QString> &changedDirs)
+{
+	foreach(const QString &dirPath, changedDirs)
+		emit directoryChanged(dirPath);
+}
+
+QString QPathMemoryFileSystemProvider::entryKey(const QString &path)
+{
+	//relative paths are relative to the root of the tree
+	QString key = QDir::cleanPath(NormalizedPath(path).toString());
+	if(!NormalizedPath::isAbsolute(key))
+		key = QDir::cleanPath(QLatin1Char('/') + key);
+	return key;
+}
+
+QString QPathMemoryFileSystemProvider::parentKey(const QString &key)
+{
+	//roots like "/" or "C:/" have no parent
+	const int index = key.lastIndexOf(QLatin1Char('/'));
+	if(index == -1 || index == key.size() - 1)
+		return QString();
+	QString parent = key.left(index);
+	if(parent.isEmpty() || parent.endsWith(QLatin1Char(':')))
+		parent.append(QLatin1Char('/'));
+	return parent;
+}
@@ -0,0 +1,103 @@
+#ifndef QPATHFILESYSTEMPROVIDER_H
+#define QPATHFILESYSTEMPROVIDER_H
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+//! The filesystem paths are validated and completed against
+class QPathFileSystemProvider : public QObject
+{
+	Q_OBJECT
+
+public:
+	//! Describes the kind of an entry
+	enum EntryType {
+		NoEntry,//!< There is no entry at the path
+		File,//!< The entry is a file
+		Directory,//!< The entry is a directory
+		Unknown//!< The entry could not be checked, because it's filesystem did not respond in time
+	};
+	Q_ENUM(EntryType)
+
+	//! A single entry of a directory
+	struct Entry {
+		QString name;//!< The name of the entry, without the directory
+		EntryType type;//!< The kind of the entry
+		bool isSymLink;//!< Specifies whether the entry is a symbolic link
+	};
+
+	//! Constructor
+	explicit QPathFileSystemProvider(QObject *parent = nullptr);
+
+	//! Returns the kind of the entry at the given path. Is called from any thread
+	virtual EntryType entryType(const QString &path) const = 0;
+	//! Returns all entries of the given directory. Is called from any thread
+	virtual QVector<Entry> entries(const QString &dirPath) const = 0;
+	//! Starts reporting changes of the given directory via QPathFileSystemProvider::directoryChanged
+	virtual void watch(const QString &dirPath);
+	//! Stops reporting changes of the given directory
+	virtual void unwatch(const QString &dirPath);
+
+	//! Returns the provider for the local filesystem, which is used by default
+	static QSharedPointer<QPathFileSystemProvider> local();
+
+signals:
+	//! Is emitted if entries were added to or removed from a directory
+	void directoryChanged(const QString &dirPath);
+};
+
+//! A provider for the local filesystem, with the stat cache and deadlines of QPathEdit
+class QPathLocalFileSystemProvider : public QPathFileSystemProvider
+{
+	Q_OBJECT
+
+public:
+	//! Constructor
+	explicit QPathLocalFileSystemProvider(QObject *parent = nullptr);
+
+	EntryType entryType(const QString &path) const override;
+	QVector<Entry> entries(const QString &dirPath) const override;
+	void watch(const QString &dirPath) override;
+	void unwatch(const QString &dirPath) override;
+};
+
+//! A provider for a virtual tree that is held in memory, for example an indexed archive
+class QPathMemoryFileSystemProvider : public QPathFileSystemProvider
+{
+	Q_OBJECT
+
+public:
+	//! Constructor
+	explicit QPathMemoryFileSystemProvider(QObject *parent = nullptr);
+
+	EntryType entryType(const QString &path) const override;
+	QVector<Entry> entries(const QString &dirPath) const override;
+
+	//! Adds a file, together with all directories above it
+	void addFile(const QString &path);
+	//! Adds a directory, together with all directories above it
+	void addDirectory(const QString &dirPath);
+	//! Removes an entry. Directories are removed with everything below them
+	void remove(const QString &path);
+	//! Removes all entries
+	void clear();
+
+private:
+	mutable QReadWriteLock lock;
+	QHash<QString, QMap<QString, EntryType>> directories;
+
+	void addEntry(const QString &key, EntryType type, QSet<QString> &changedDirs);
+	void removeTree(const QString &key, QSet<QString> &changedDirs);
+	void emitChanges(const QSet<QString> &changedDirs);
+
+	static QString entryKey(const QString &path);
+	static QString parentKey(const QString &key);
+};
+
+#endif // QPATHFILESYSTEMPROVIDER_H
@@ -0,0 +1,1046 @@
+#include "qpathvalidation.h"
+#include "qpathvalidation_p.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QRegularExpressionMatch>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <functional>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#endif
+
+Q_LOGGING_CATEGORY(qpatheditPerformance, "qpathedit.performance", QtWarningMsg)
+
+Q_GLOBAL_STATIC(QThreadPool, validationPool)
+Q_GLOBAL_STATIC(PathStatCache, statCache)
+Q_GLOBAL_STATIC(MimeTypeCache, mimeTypeCache)
+
+//stats on hung mounts may never return, so the pool is never destroyed, as that would wait for them.
+//Each hung stat gives its thread back to the pool, so they can never fill it up
+static QThreadPool *statPool()
+{
+	static QThreadPool *pool = [](){
+		QThreadPool *statPool = new QThreadPool();
+		statPool->setMaxThreadCount(16);
+		return statPool;
+	}();
+	return pool;
+}
+
+//slow mounts are skipped for this time in milliseconds, before they are checked again
+static const qint64 SlowMountRetry = 30000;
+//the mount table is read again after this time in milliseconds
+static const qint64 MountTableTimeout = 10000;
+//the start value of the hashes of name filter suffixes
+static const uint SuffixHashSeed = 2166136261u;
+//name filters follow the case sensitivity of the platforms filesystem, like the completer does
+#ifdef Q_OS_WIN
+static const Qt::CaseSensitivity FilterCaseSensitivity = Qt::CaseInsensitive;
+#else
+static const Qt::CaseSensitivity FilterCaseSensitivity = Qt::CaseSensitive;
+#endif
+
+QPathValidation::QPathValidation(QPathValidation::Mode mode, bool allowEmptyPath) :
+	validationMode(mode),
+	allowEmpty(allowEmptyPath),
+	nameFilterList(),
+	filterMatcher(),
+	separator(QLatin1Char(';')),
+	fsProvider()
+{}
+
+QPathValidation::Mode QPathValidation::mode() const
+{
+	return validationMode;
+}
+
+bool QPathValidation::isEmptyPathAllowed() const
+{
+	return allowEmpty;
+}
+
+QStringList QPathValidation::nameFilters() const
+{
+	return nameFilterList;
+}
+
+QChar QPathValidation::pathSeparator() const
+{
+	return separator;
+}
+
+void QPathValidation::setMode(QPathValidation::Mode mode)
+{
+	validationMode = mode;
+}
+
+void QPathValidation::setAllowEmptyPath(bool allowEmptyPath)
+{
+	allowEmpty = allowEmptyPath;
+}
+
+void QPathValidation::setNameFilters(const QStringList &nameFilters)
+{
+	nameFilterList = nameFilters;
+	if(nameFilters.isEmpty())
+		filterMatcher.reset();
+	else
+		filterMatcher.reset(new NameFilterMatcher(nameFilters));
+}
+
+void QPathValidation::setPathSeparator(QChar pathSeparator)
+{
+	separator = pathSeparator;
+}
+
+QSharedPointer<QPathFileSystemProvider> QPathValidation::fileSystemProvider() const
+{
+	return fsProvider ? fsProvider : QPathFileSystemProvider::local();
+}
+
+void QPathValidation::setFileSystemProvider(const QSharedPointer<QPathFileSystemProvider> &provider)
+{
+	//the default provider is not stored, so the checks can use the stat cache directly
+	if(provider == QPathFileSystemProvider::local())
+		fsProvider.reset();
+	else
+		fsProvider = provider;
+}
+
+QPathValidation::State QPathValidation::validate(const QString &path) const
+{
+	if(validationMode == ExistingFiles) {
+		QVector<State> states = PathChecker::checkPaths(PathChecker::splitPaths(path, separator), validationMode, allowEmpty, filterMatcher, fsProvider.data());
+		return PathChecker::combineStates(states, validationMode, allowEmpty);
+	} else
+		return PathChecker::checkPath(path, validationMode, allowEmpty, filterMatcher, fsProvider.data());
+}
+
+QVector<QPathValidation::State> QPathValidation::validate(const QStringList &paths) const
+{
+	return PathChecker::checkPaths(paths, validationMode, allowEmpty, filterMatcher, fsProvider.data());
+}
+
+int QPathValidation::statDeadline()
+{
+	return PathStatCache::instance()->deadline();
+}
+
+void QPathValidation::setStatDeadline(int msecs)
+{
+	PathStatCache::instance()->setDeadline(msecs);
+}
+
+QFuture<QPathValidation::State> QPathValidation::validateConcurrent(const QStringList &paths) const
+{
+	//the results are reported in blocks as they become ready, see QFutureWatcher::resultsReadyAt
+	Mode mode = validationMode;
+	bool emptyAllowed = allowEmpty;
+	NameFilterMatcherPtr matcher = filterMatcher;
+	QSharedPointer<QPathFileSystemProvider> provider = fsProvider;
+	std::function<State(const QString &)> check = [mode, emptyAllowed, matcher, provider](const QString &path) {
+		return PathChecker::checkPath(path, mode, emptyAllowed, matcher, provider.data());
+	};
+	return QtConcurrent::mapped(paths, check);
+}
+
+//HELPER CLASSES IMPLEMENTATION
+
+QThreadPool *PathChecker::threadPool()
+{
+	return validationPool();
+}
+
+QPathValidation::State PathChecker::checkPath(const QString &text,
+											  QPathValidation::Mode mode,
+											  bool allowEmpty,
+											  const NameFilterMatcherPtr &matcher,
+											  const QPathFileSystemProvider *provider,
+											  PerformanceCounters *counters,
+											  PrefixMemo *memo)
+{
+	QElapsedTimer timer;
+	timer.start();
+	PerformanceCounters::count(counters, QPathEditStatistics::Validations);
+	QPathValidation::State state = checkPathState(text, mode, allowEmpty, matcher, provider, counters, memo);
+	qint64 nsecs = timer.nsecsElapsed();
+	PerformanceCounters::time(counters, QPathEditStatistics::ValidationTime, nsecs);
+	qCDebug(qpatheditPerformance) << "Validated" << text << "in" << nsecs / 1000 << "us";
+	return state;
+}
+
+QVector<QPathValidation::State> PathChecker::checkPaths(const QStringList &paths,
+														QPathValidation::Mode mode,
+														bool allowEmpty,
+														const NameFilterMatcherPtr &matcher,
+														const QPathFileSystemProvider *provider,
+														PerformanceCounters *counters)
+{
+	QVector<QPathValidation::State> states(paths.size());
+	QPathValidation::State *stateData = states.data();
+
+	//the paths are split into one chunk per thread, but tiny chunks are not worth the handover
+	const int threadCount = qMax(threadPool()->maxThreadCount(), 1);
+	const int chunkSize = qMax(64, (paths.size() + threadCount - 1) / threadCount);
+	if(paths.size() <= chunkSize) {
+		for(int i = 0; i < paths.size(); ++i)
+			stateData[i] = checkPath(paths[i], mode, allowEmpty, matcher, provider, counters);
+		return states;
+	}
+
+	QList<QFuture<void>> futures;
+	for(int begin = 0; begin < paths.size(); begin += chunkSize) {
+		const int end = qMin(begin + chunkSize, paths.size());
+		futures.append(QtConcurrent::run(threadPool(), [&paths, &matcher, stateData, begin, end, mode, allowEmpty, provider, counters](){
+			for(int i = begin; i < end; ++i)
+				stateData[i] = checkPath(paths[i], mode, allowEmpty, matcher, provider, counters);
+		}));
+	}
+	//waiting steals chunks that did not start yet, so this cannot starve the pool
+	foreach(QFuture<void> future, futures)
+		future.waitForFinished();
+	return states;
+}
+
+QPathValidation::State PathChecker::combineStates(const QVector<QPathValidation::State> &states,
+												  QPathValidation::Mode mode,
+												  bool allowEmpty)
+{
+	if(mode != QPathValidation::ExistingFiles)
+		return states.isEmpty() ? QPathValidation::Invalid : states.first();
+
+	//a single bad entry must not block typing the others, so the text is never invalid as a whole
+	if(states.isEmpty())
+		return allowEmpty ? QPathValidation::Acceptable : QPathValidation::Intermediate;
+	QPathValidation::State result = QPathValidation::Acceptable;
+	foreach(QPathValidation::State state, states) {
+		if(state == QPathValidation::Unverified)
+			result = QPathValidation::Unverified;
+		else if(state != QPathValidation::Acceptable)
+			return QPathValidation::Intermediate;
+	}
+	return result;
+}
+
+QStringList PathChecker::splitPaths(const QString &text, QChar separator)
+{
+	QStringList paths;
+	foreach(const QString &entry, text.split(separator)) {
+		QString path = entry.trimmed();
+		if(!path.isEmpty())
+			paths.append(path);
+	}
+	return paths;
+}
+
+PathStat PathChecker::stat(const QString &path, const QPathFileSystemProvider *provider, PerformanceCounters *counters)
+{
+	if(!provider)
+		return PathStatCache::instance()->stat(path, counters);
+
+	PerformanceCounters::count(counters, QPathEditStatistics::StatCalls);
+	switch(provider->entryType(path)) {
+	case QPathFileSystemProvider::NoEntry:
+		return PathStat {false, false, false, true, {}};
+	case QPathFileSystemProvider::File:
+		return PathStat {true, true, false, true, {}};
+	case QPathFileSystemProvider::Directory:
+		return PathStat {true, false, true, true, {}};
+	case QPathFileSystemProvider::Unknown:
+		PerformanceCounters::count(counters, QPathEditStatistics::StatTimeouts);
+		return PathStat {false, false, false, false, {}};
+	default:
+		Q_UNREACHABLE();
+	}
+
+	return PathStat {false, false, false, false, {}};
+}
+
+QPathValidation::State PathChecker::checkPathState(const QString &text,
+												   QPathValidation::Mode mode,
+												   bool allowEmpty,
+												   const NameFilterMatcherPtr &matcher,
+												   const QPathFileSystemProvider *provider,
+												   PerformanceCounters *counters,
+												   PrefixMemo *memo)
+{
+	//check if empty is accepted
+	if(text.isEmpty())
+		return allowEmpty ? QPathValidation::Acceptable : QPathValidation::Intermediate;
+
+	//nonexisting parent dir is not possible. It only needs to be checked again if the part
+	//before the last separator changed, not while typing the name
+	PathStatCache *cache = PathStatCache::instance();
+	const NormalizedPath path(text);
+	const QStringRef prefix = path.directoryPrefix();
+	if(provider)
+		memo = nullptr;//the memo only knows about changes of the local filesystem
+	else if(!NormalizedPath::isAbsolute(path.toString()))
+		memo = nullptr;//relative prefixes point somewhere else once the working directory changes
+	if(!memo || !memo->isConfirmed(prefix)) {
+		const quint64 epoch = cache->epoch();
+		//other providers resolve relative paths themselves, so the prefix is passed as it is
+		QString parentPath;
+		if(!provider)
+			parentPath = QFileInfo(path.toString()).absolutePath();
+		else if(prefix.isEmpty())
+			parentPath = QStringLiteral(".");
+		else
+			parentPath = prefix.toString();
+		PathStat parentStat = stat(parentPath, provider, counters);
+		if(!parentStat.verified)
+			return QPathValidation::Unverified;
+		if(!parentStat.isDir)
+			return QPathValidation::Invalid;
+		if(memo)
+			memo->confirm(prefix, epoch);
+	}
+
+	PathStat pathStat = stat(path.toString(), provider, counters);
+	if(!pathStat.verified)
+		return QPathValidation::Unverified;
+	bool filterMatched = !matcher || matcher->matches(path.fileName());
+	switch(mode) {
+	case QPathValidation::AnyFile://acceptable, as long as it's not an directoy
+		if(pathStat.isDir || !filterMatched)
+			return QPathValidation::Intermediate;
+		else
+			return QPathValidation::Acceptable;
+	case QPathValidation::ExistingFile://must be an existing file
+	case QPathValidation::ExistingFiles://each entry is checked on it's own
+		if(pathStat.exists && pathStat.isFile && filterMatched)
+			return QPathValidation::Acceptable;
+		else
+			return QPathValidation::Intermediate;
+	case QPathValidation::ExistingFolder://must be an existing folder
+		if(pathStat.exists && pathStat.isDir)
+			return QPathValidation::Acceptable;
+		else
+			return QPathValidation::Intermediate;
+	default:
+		Q_UNREACHABLE();
+	}
+
+	return QPathValidation::Invalid;
+}
+
+NameFilterMatcher::NameFilterMatcher(const QStringList &nameFilters) :
+	empty(true),
+	matchAll(false),
+	suffixes(),
+	wildcards()
+{
+	// regexp copied from Qt sources QPlatformFileDialogHelper::filterRegExp
+	static const QRegularExpression filterRegexp(QStringLiteral("^(.*)\\(([a-zA-Z0-9_.,*? +;#\\-\\[\\]@\\{\\}/!<>\\$%&=^~:\\|]*)\\)$"));
+	static const QRegularExpression spaceRegexp(QStringLiteral("\\s+"));
+	static const QRegularExpression wildcardRegexp(QStringLiteral("[*?\\[]"));
+
+	// Makes a ["*.png", "*.jpg", "*.bmp"] formatted list of patterns
+	// from the filters in format ["Image Files (*.png *.jpg)", "Bitmaps (*.bmp)"]
+	foreach(const QString &filter, nameFilters) {
+		QString patterns = filter;
+		QRegularExpressionMatch match = filterRegexp.match(filter);
+		if(match.hasMatch())
+			patterns = match.captured(2);
+
+		foreach(const QString &pattern, patterns.split(spaceRegexp, QString::SkipEmptyParts)) {
+			empty = false;
+			if(pattern == QStringLiteral("*") || pattern == QStringLiteral("*.*"))
+				matchAll = true;
+			else if(pattern.startsWith(QStringLiteral("*.")) &&
+					pattern.indexOf(wildcardRegexp, 2) == -1) {
+				QString suffix = pattern.mid(2);
+				//hashed from the end, just like the names are scanned when matching
+				uint hash = SuffixHashSeed;
+				for(int i = suffix.size() - 1; i >= 0; --i)
+					hash = suffixHash(hash, suffix[i]);
+				if(!suffixes.contains(hash, suffix))
+					suffixes.insert(hash, suffix);
+			} else {
+				QRegularExpression regexp(wildcardToRegularExpression(pattern),
+										  FilterCaseSensitivity == Qt::CaseInsensitive ?
+											  QRegularExpression::CaseInsensitiveOption :
+											  QRegularExpression::NoPatternOption);
+				regexp.optimize();
+				wildcards.append(regexp);
+			}
+		}
+	}
+}
+
+bool NameFilterMatcher::isEmpty() const
+{
+	return empty;
+}
+
+bool NameFilterMatcher::matches(const QString &fileName) const
+{
+	return matches(QStringRef(&fileName));
+}
+
+bool NameFilterMatcher::matches(const QStringRef &fileName) const
+{
+	if(empty || matchAll)
+		return true;
+
+	//the name is hashed from its end, so every dot is a single lookup of the suffix behind it,
+	//without lowering or copying the name. This way patterns like "*.tar.gz" work too
+	if(!suffixes.isEmpty()) {
+		uint hash = SuffixHashSeed;
+		for(int i = fileName.size() - 1; i >= 0; --i) {
+			const QChar c = fileName.at(i);
+			if(c == QLatin1Char('.')) {
+				const QStringRef suffix = fileName.mid(i + 1);
+				for(auto it = suffixes.constFind(hash); it != suffixes.constEnd() && it.key() == hash; ++it) {
+					if(suffix.compare(it.value(), FilterCaseSensitivity) == 0)
+						return true;
+				}
+			}
+			hash = suffixHash(hash, c);
+		}
+	}
+
+	foreach(const QRegularExpression &regexp, wildcards) {
+		if(regexp.match(fileName).hasMatch())
+			return true;
+	}
+	return false;
+}
+
+uint NameFilterMatcher::suffixHash(uint hash, QChar c)
+{
+	//FNV-1a over the lowered characters, so the hash works for both case sensitivities
+	return (hash ^ c.toLower().unicode()) * 16777619u;
+}
+
+QString NameFilterMatcher::wildcardToRegularExpression(const QString &pattern)
+{
+	QString regexp;
+	regexp.reserve(pattern.size() * 2 + 2);
+	regexp.append(QLatin1Char('^'));
+	bool inBrackets = false;
+	QChar previous;
+	foreach(const QChar &c, pattern) {
+		if(inBrackets) {
+			if(c == QLatin1Char(']'))
+				inBrackets = false;
+			if(c == QLatin1Char('!') && previous == QLatin1Char('['))
+				regexp.append(QLatin1Char('^'));
+			else if(c == QLatin1Char('\\'))
+				regexp.append(QStringLiteral("\\\\"));
+			else
+				regexp.append(c);
+		} else if(c == QLatin1Char('*'))
+			regexp.append(QStringLiteral(".*"));
+		else if(c == QLatin1Char('?'))
+			regexp.append(QLatin1Char('.'));
+		else if(c == QLatin1Char('[')) {
+			inBrackets = true;
+			regexp.append(c);
+		} else
+			regexp.append(QRegularExpression::escape(QString(c)));
+		previous = c;
+	}
+	regexp.append(QLatin1Char('$'));
+	return regexp;
+}
+
+NormalizedPath::NormalizedPath(const QString &path) :
+	path(path)
+{
+	//the text is shared as long as it has no backslashes, otherwise it's copied once
+	const int first = path.indexOf(QLatin1Char('\\'));
+	if(first != -1) {
+		QChar *data = this->path.data();
+		for(int i = first; i < this->path.size(); ++i) {
+			if(data[i] == QLatin1Char('\\'))
+				data[i] = QLatin1Char('/');
+		}
+	}
+}
+
+const QString &NormalizedPath::toString() const
+{
+	return path;
+}
+
+QStringRef NormalizedPath::fileName() const
+{
+	return path.midRef(path.lastIndexOf(QLatin1Char('/')) + 1);
+}
+
+QStringRef NormalizedPath::directoryPrefix() const
+{
+	return path.leftRef(path.lastIndexOf(QLatin1Char('/')) + 1);
+}
+
+bool NormalizedPath::isAbsolute(const QString &path)
+{
+	//the same rules as QFileInfo::isAbsolute, but without creating one
+	if(path.startsWith(QLatin1Char(':')))//resources
+		return true;
+#ifdef Q_OS_WIN
+	auto isSeparator = [&path](int index) {
+		return index < path.size() &&
+				(path[index] == QLatin1Char('/') || path[index] == QLatin1Char('\\'));
+	};
+	return (path.size() >= 3 && path[0].isLetter() && path[1] == QLatin1Char(':') && isSeparator(2)) ||
+			(isSeparator(0) && isSeparator(1));
+#else
+	return path.startsWith(QLatin1Char('/'));
+#endif
+}
+
+PathStatCache::PathStatCache() :
+	QObject(),
+	mutex(),
+	clock(),
+	ttl(5000),
+	size(1024),
+	statDeadline(2000),
+	entries(),
+	lru(),
+	dirRefs(),
+	unwatchedDirs(),
+	watcher(new QFileSystemWatcher(this)),
+	mountPoints(),
+	remoteMounts(),
+	mountsTimestamp(-MountTableTimeout),
+	slowMounts(),
+	slowHistory(),
+	hungStats(),
+	changeEpoch(0)
+{
+	clock.start();
+	//the watcher must live in the main thread, even if the first stat comes from a worker
+	if(QCoreApplication::instance())
+		moveToThread(QCoreApplication::instance()->thread());
+	connect(watcher, &QFileSystemWatcher::directoryChanged,
+			this, &PathStatCache::invalidateDirectory);
+}
+
+PathStatCache *PathStatCache::instance()
+{
+	return statCache();
+}
+
+PathStat PathStatCache::stat(const QString &path, PerformanceCounters *counters)
+{
+	//cache hits of absolute paths must not allocate anything
+	const QString key = NormalizedPath::isAbsolute(path) ? path : QFileInfo(path).absoluteFilePath();
+
+	{
+		QMutexLocker locker(&mutex);
+		auto it = entries.find(key);
+		if(it != entries.end()) {
+			if(clock.elapsed() - it->timestamp <= ttl) {
+				lru.splice(lru.begin(), lru, it->lruPos);
+				PerformanceCounters::count(counters, QPathEditStatistics::CacheHits);
+				return it->stat;
+			} else
+				removeEntry(it);
+		}
+	}
+
+	//paths on mounts that recently missed a deadline are not even tried
+	QString mount;
+	int msecs;
+	bool inlineStat = true;
+	{
+		QMutexLocker locker(&mutex);
+		msecs = statDeadline;
+		if(msecs > 0) {
+			mount = mountPoint(key);
+			//while a stat on the mount still hangs, another one would only hang as well
+			if(hungStats.contains(mount)) {
+				PerformanceCounters::count(counters, QPathEditStatistics::StatTimeouts);
+				return PathStat {false, false, false, false, {}};
+			}
+			//local disks that never missed a deadline are not worth the thread round trip
+			inlineStat = !slowHistory.contains(mount) && !isRemoteMount(mount);
+			auto slow = slowMounts.find(mount);
+			if(slow != slowMounts.end()) {
+				if(clock.elapsed() - slow.value() < SlowMountRetry) {
+					PerformanceCounters::count(counters, QPathEditStatistics::StatTimeouts);
+					return PathStat {false, false, false, false, {}};
+				} else
+					slowMounts.erase(slow);
+			}
+		}
+	}
+
+	//the actual stat is done unlocked, as it might block for a long time
+	PerformanceCounters::count(counters, QPathEditStatistics::StatCalls);
+	PathStat result = inlineStat ? statPath(key) : statWithDeadline(key, mount, msecs);
+	if(!result.verified) {
+		PerformanceCounters::count(counters, QPathEditStatistics::StatTimeouts);
+		qCDebug(qpatheditPerformance) << "Stat of" << key << "missed the deadline, skipping mount" << mount;
+		return result;
+	}
+
+	QFileInfo info(key);
+	const QString dirPath = info.absolutePath();
+	QMutexLocker locker(&mutex);
+	if(size <= 0 || ttl <= 0)
+		return result;
+	//nothing reports a missing directory beeing created, so the entries in it are not cached
+	if(!result.exists && unwatchedDirs.contains(dirPath))
+		return result;
+
+	auto it = entries.find(key);
+	if(it != entries.end())//inserted by another thread in the meantime
+		removeEntry(it);
+	while(entries.size() >= size)
+		removeEntry(entries.find(lru.back()));
+
+	Entry entry;
+	entry.stat = result;
+	entry.timestamp = clock.elapsed();
+	entry.dirPath = dirPath;
+	lru.push_front(key);
+	entry.lruPos = lru.begin();
+	entries.insert(key, entry);
+	if(dirRefs[entry.dirPath]++ == 0) {
+		QMetaObject::invokeMethod(this, "watchDirectory", Qt::QueuedConnection,
+								  Q_ARG(QString, entry.dirPath));
+	}
+
+	return result;
+}
+
+int PathStatCache::timeout() const
+{
+	QMutexLocker locker(&mutex);
+	return ttl;
+}
+
+void PathStatCache::setTimeout(int msecs)
+{
+	QMutexLocker locker(&mutex);
+	ttl = msecs;
+}
+
+int PathStatCache::maxSize() const
+{
+	QMutexLocker locker(&mutex);
+	return size;
+}
+
+void PathStatCache::setMaxSize(int size)
+{
+	QMutexLocker locker(&mutex);
+	this->size = size;
+	while(!entries.isEmpty() && entries.size() > qMax(size, 0))
+		removeEntry(entries.find(lru.back()));
+}
+
+int PathStatCache::deadline() const
+{
+	QMutexLocker locker(&mutex);
+	return statDeadline;
+}
+
+void PathStatCache::setDeadline(int msecs)
+{
+	QMutexLocker locker(&mutex);
+	statDeadline = msecs;
+	if(msecs <= 0)
+		slowMounts.clear();
+}
+
+void PathStatCache::watchDirectory(const QString &dirPath)
+{
+	QMutexLocker locker(&mutex);
+	//the entries might have been removed again before this queued call arrived
+	if(!dirRefs.contains(dirPath) || watcher->directories().contains(dirPath))
+		return;
+	if(watcher->addPath(dirPath)) {
+		unwatchedDirs.remove(dirPath);
+		return;
+	}
+
+	//a directory that cannot be watched, usually because it does not exist, never reports changes.
+	//Its entries are dropped, so they are checked again instead of staying stale
+	if(unwatchedDirs.size() >= 1024)
+		unwatchedDirs.clear();
+	unwatchedDirs.insert(dirPath);
+	for(auto it = entries.begin(); it != entries.end();) {
+		if(it->dirPath == dirPath) {
+			releaseDirectory(it->dirPath);
+			lru.erase(it->lruPos);
+			it = entries.erase(it);
+		} else
+			++it;
+	}
+}
+
+void PathStatCache::unwatchDirectory(const QString &dirPath)
+{
+	QMutexLocker locker(&mutex);
+	if(!dirRefs.contains(dirPath))
+		watcher->removePath(dirPath);
+}
+
+quint64 PathStatCache::epoch() const
+{
+	return changeEpoch.load();
+}
+
+bool PathStatCache::isSlowMount(const QString &path)
+{
+	const QString key = NormalizedPath::isAbsolute(path) ? path : QFileInfo(path).absoluteFilePath();
+	QMutexLocker locker(&mutex);
+	if(statDeadline <= 0)
+		return false;
+	//a mount that missed a deadline once stays suspicious, even after it answered again
+	const QString mount = mountPoint(key);
+	return slowHistory.contains(mount) || hungStats.contains(mount);
+}
+
+void PathStatCache::watch(const QString &dirPath)
+{
+	//shares the references with the cached entries, so every directory is watched only once
+	QMutexLocker locker(&mutex);
+	if(dirRefs[dirPath]++ == 0) {
+		QMetaObject::invokeMethod(this, "watchDirectory", Qt::QueuedConnection,
+								  Q_ARG(QString, dirPath));
+	}
+}
+
+void PathStatCache::unwatch(const QString &dirPath)
+{
+	QMutexLocker locker(&mutex);
+	releaseDirectory(dirPath);
+}
+
+void PathStatCache::invalidateDirectory(const QString &dirPath)
+{
+	{
+		QMutexLocker locker(&mutex);
+		//confirmed prefixes might not exist anymore
+		changeEpoch.fetchAndAddOrdered(1);
+		//drops the changed directory itself and all its direct children
+		for(auto it = entries.begin(); it != entries.end();) {
+			if(it->dirPath == dirPath || it.key() == dirPath) {
+				releaseDirectory(it->dirPath);
+				lru.erase(it->lruPos);
+				it = entries.erase(it);
+			} else
+				++it;
+		}
+	}
+	//reported only now, so a check of the changed directory never gets stale results
+	emit directoryChanged(dirPath);
+}
+
+PathStat PathStatCache::statWithDeadline(const QString &path, const QString &mountPoint, int msecs)
+{
+	//state: 0 while running, 1 if the worker finished first, 2 if the caller gave up first
+	QSharedPointer<PendingStat> pending(new PendingStat());
+	QtConcurrent::run(statPool(), [pending, path, mountPoint](){
+		pending->result = statPath(path);
+		if(pending->state.testAndSetOrdered(0, 1))
+			pending->done.release();
+		else {
+			//the thread was given back when the caller gave up, so it is taken from the pool again
+			statPool()->reserveThread();
+			if(PathStatCache *cache = statCache()) {
+				//a late answer still proves that the mount is responsive again
+				QMutexLocker locker(&cache->mutex);
+				cache->addHungStat(mountPoint, -1);
+				cache->setMountSlow(mountPoint, false);
+			}
+		}
+	});
+
+	if(pending->done.tryAcquire(1, msecs))
+		return pending->result;
+	if(!pending->state.testAndSetOrdered(0, 2)) {
+		//the worker finished right after the deadline
+		pending->done.acquire();
+		return pending->result;
+	}
+
+	//the hung stat must not take a thread from stats on other mounts
+	statPool()->releaseThread();
+	QMutexLocker locker(&mutex);
+	addHungStat(mountPoint, 1);
+	setMountSlow(mountPoint, true);
+	return PathStat {false, false, false, false, {}};
+}
+
+QString PathStatCache::mountPoint(const QString &path)
+{
+#ifdef Q_OS_WIN
+	//drives and network shares are the mounts, and they can be taken from the path itself
+	QString cleanPath = QDir::fromNativeSeparators(path);
+	if(cleanPath.startsWith(QStringLiteral("//"))) {
+		int shareIndex = cleanPath.indexOf(QLatin1Char('/'), 2);
+		int endIndex = shareIndex == -1 ? -1 : cleanPath.indexOf(QLatin1Char('/'), shareIndex + 1);
+		return endIndex == -1 ? cleanPath : cleanPath.left(endIndex);
+	} else
+		return cleanPath.left(2);
+#else
+	if(clock.elapsed() - mountsTimestamp > MountTableTimeout) {
+		mountPoints = readMountPoints(remoteMounts);
+		mountsTimestamp = clock.elapsed();
+	}
+
+	//the mount points are sorted by length, so the first match is the innermost mount
+	foreach(const QString &mount, mountPoints) {
+		if(path == mount ||
+		   (path.startsWith(mount) && (mount.endsWith(QLatin1Char('/')) || path[mount.size()] == QLatin1Char('/'))))
+			return mount;
+	}
+
+	//without a mount table, the first directory below the root is the best guess
+	int endIndex = path.indexOf(QLatin1Char('/'), 1);
+	if(path.startsWith(QStringLiteral("/Volumes/")))
+		endIndex = path.indexOf(QLatin1Char('/'), 9);
+	return endIndex == -1 ? path : path.left(endIndex);
+#endif
+}
+
+bool PathStatCache::isRemoteMount(const QString &mountPoint) const
+{
+#ifdef Q_OS_WIN
+	//asking for the drive type does not touch the drive itself
+	if(mountPoint.startsWith(QStringLiteral("//")))
+		return true;
+	QString root = QDir::toNativeSeparators(mountPoint + QLatin1Char('/'));
+	return GetDriveTypeW(reinterpret_cast<const wchar_t*>(root.utf16())) == DRIVE_REMOTE;
+#elif defined(Q_OS_LINUX)
+	//without a mount table, nothing is known about the mount
+	return mountPoints.isEmpty() || remoteMounts.contains(mountPoint);
+#else
+	Q_UNUSED(mountPoint);
+	return true;
+#endif
+}
+
+void PathStatCache::setMountSlow(const QString &mountPoint, bool slow)
+{
+	if(slow) {
+		slowMounts.insert(mountPoint, clock.elapsed());
+		slowHistory.insert(mountPoint);
+	} else
+		slowMounts.remove(mountPoint);
+}
+
+void PathStatCache::addHungStat(const QString &mountPoint, int delta)
+{
+	//the late worker may finish before the caller counted it, so the count can drop below zero for a moment
+	auto it = hungStats.insert(mountPoint, hungStats.value(mountPoint) + delta);
+	if(it.value() == 0)
+		hungStats.erase(it);
+}
+
+void PathStatCache::removeEntry(QHash<QString, Entry>::iterator it)
+{
+	releaseDirectory(it->dirPath);
+	lru.erase(it->lruPos);
+	entries.erase(it);
+}
+
+void PathStatCache::releaseDirectory(const QString &dirPath)
+{
+	auto ref = dirRefs.find(dirPath);
+	if(ref != dirRefs.end() && --ref.value() == 0) {
+		dirRefs.erase(ref);
+		QMetaObject::invokeMethod(this, "unwatchDirectory", Qt::QueuedConnection,
+								  Q_ARG(QString, dirPath));
+	}
+}
+
+PrefixMemo::PrefixMemo() :
+	mutex(),
+	confirmedPrefix(),
+	epoch(0),
+	timer(),
+	validFor(0)
+{}
+
+bool PrefixMemo::isConfirmed(const QStringRef &prefix) const
+{
+	QMutexLocker locker(&mutex);
+	//the confirmation expires like a cached stat, or as soon as any watched directory changes
+	return timer.isValid() &&
+			timer.elapsed() < validFor &&
+			epoch == PathStatCache::instance()->epoch() &&
+			confirmedPrefix == prefix;
+}
+
+void PrefixMemo::confirm(const QStringRef &prefix, quint64 checkedEpoch)
+{
+	//the epoch from before the check is used, so changes during the check are not missed
+	int ttl = PathStatCache::instance()->timeout();
+	QMutexLocker locker(&mutex);
+	confirmedPrefix = prefix.toString();
+	epoch = checkedEpoch;
+	validFor = ttl;
+	timer.start();
+}
+
+MimeTypeCache::MimeTypeCache() :
+	mutex(),
+	mimeTypes(),
+	order()
+{}
+
+MimeTypeCache *MimeTypeCache::instance()
+{
+	return mimeTypeCache();
+}
+
+QString MimeTypeCache::mimeType(const QString &path)
+{
+	//the stat takes the deadlines into account, so a dead mount never blocks a validation thread
+	const PathStat pathStat = PathStatCache::instance()->stat(path);
+	if(pathStat.verified && !pathStat.isFile)
+		return QString();
+	//reading the content of a slow mount could hang just like a stat, so only the name is used there
+	if(!pathStat.verified || PathStatCache::instance()->isSlowMount(path))
+		return QMimeDatabase().mimeTypeForFile(path, QMimeDatabase::MatchExtension).name();
+
+	const FileKey key = fileKey(path, pathStat.file);
+
+	{
+		QMutexLocker locker(&mutex);
+		auto it = mimeTypes.constFind(key);
+		if(it != mimeTypes.constEnd())
+			return it.value();
+	}
+
+	//reading the content is done unlocked, as it might take a while
+	const QString mimeName = QMimeDatabase().mimeTypeForFile(path, QMimeDatabase::MatchContent).name();
+	QMutexLocker locker(&mutex);
+	if(!mimeTypes.contains(key)) {
+		while(order.size() >= 4096)
+			mimeTypes.remove(order.dequeue());
+		mimeTypes.insert(key, mimeName);
+		order.enqueue(key);
+	}
+	return mimeName;
+}
+
+bool MimeTypeCache::matches(const QString &path, const QStringList &mimeFilters)
+{
+	const QString mimeName = mimeType(path);
+	if(mimeName.isNull())
+		return false;
+
+	QMimeDatabase mimeDb;
+	const QMimeType mime = mimeDb.mimeTypeForName(mimeName);
+	foreach(const QString &filter, mimeFilters) {
+		//same as the "All files (*)" filter of the dialog
+		if(filter == QStringLiteral("application/octet-stream") || mime.inherits(filter))
+			return true;
+	}
+	return false;
+}
+
+bool MimeTypeCache::FileKey::operator==(const MimeTypeCache::FileKey &other) const
+{
+	return device == other.device &&
+			inode == other.inode &&
+			modified == other.modified &&
+			size == other.size &&
+			path == other.path;
+}
+
+uint qHash(const MimeTypeCache::FileKey &key, uint seed)
+{
+	return qHash(key.inode, seed) ^ qHash(key.modified, seed) ^ qHash(key.path, seed);
+}
+
+MimeTypeCache::FileKey MimeTypeCache::fileKey(const QString &path, const FileIdentity &file)
+{
+	FileKey key;
+	key.device = file.device;
+	key.inode = file.inode;
+	key.modified = file.modified;
+	key.size = file.size;
+	//the inode identifies the file, so moved or hard linked files are not sniffed again, without one the path is used
+	if(file.inode == 0)
+		key.path = QFileInfo(path).absoluteFilePath();
+	return key;
+}
+
+PathStat PathStatCache::statPath(const QString &path)
+{
+	PathStat result {false, false, false, true, {}};
+#ifdef Q_OS_UNIX
+	//a single stat also gives the identity of the file, which the mime type cache uses
+	struct stat statBuffer;
+	if(::stat(QFile::encodeName(path).constData(), &statBuffer) != 0)
+		return result;
+	result.exists = true;
+	result.isFile = S_ISREG(statBuffer.st_mode);
+	result.isDir = S_ISDIR(statBuffer.st_mode);
+	result.file.device = statBuffer.st_dev;
+	result.file.inode = statBuffer.st_ino;
+	result.file.modified = statBuffer.st_mtime;
+	result.file.size = statBuffer.st_size;
+#else
+	QFileInfo info(path);
+	result.exists = info.exists();
+	result.isFile = result.exists && info.isFile();
+	result.isDir = result.exists && info.isDir();
+	if(result.isFile) {
+		result.file.modified = info.lastModified().toMSecsSinceEpoch();
+		result.file.size = info.size();
+	}
+#endif
+	return result;
+}
+
+QStringList PathStatCache::readMountPoints(QSet<QString> &remoteMounts)
+{
+	QStringList mounts;
+	remoteMounts.clear();
+#ifdef Q_OS_LINUX
+	//reading the mount table never touches the mounts themselves, unlike QStorageInfo
+	QFile mountsFile(QStringLiteral("/proc/self/mounts"));
+	if(!mountsFile.open(QIODevice::ReadOnly | QIODevice::Text))
+		return mounts;
+	foreach(const QByteArray &line, mountsFile.readAll().split('\n')) {
+		QList<QByteArray> fields = line.split(' ');
+		if(fields.size() < 3)
+			continue;
+		//spaces and other special characters are escaped as octal numbers
+		QByteArray mount = fields[1];
+		QByteArray decoded;
+		decoded.reserve(mount.size());
+		for(int i = 0; i < mount.size(); ++i) {
+			if(mount[i] == '\\' && i + 3 < mount.size()) {
+				decoded.append(static_cast<char>(mount.mid(i + 1, 3).toInt(nullptr, 8)));
+				i += 3;
+			} else
+				decoded.append(mount[i]);
+		}
+		mounts.append(QFile::decodeName(decoded));
+		//network filesystems and FUSE mounts may hang, local disks are checked without a deadline
+		static const QList<QByteArray> remoteTypes {
+			"nfs", "nfs4", "cifs", "smb3", "smbfs", "ncpfs", "afs", "9p", "ceph",
+			"glusterfs", "lustre", "gpfs", "davfs", "autofs"
+		};
+		const QByteArray &type = fields[2];
+		if(type.startsWith("fuse") || remoteTypes.contains(type))
+			remoteMounts.insert(mounts.last());
+	}
+	std::sort(mounts.begin(), mounts.end(), [](const QString &lhs, const QString &rhs){
+		return lhs.size() > rhs.size();
+	});
+#endif
+	return mounts;
+}
@@ -0,0 +1,80 @@
+#ifndef QPATHVALIDATION_H
+#define QPATHVALIDATION_H
+
+#include <QFuture>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "qpathfilesystemprovider.h"
+
+class NameFilterMatcher;
+
+//! Validates paths with the same rules as the QPathEdit, but without any widget
+class QPathValidation
+{
+public:
+	//! Describes modes for the kind of path. The values are the same as for QPathEdit::PathMode
+	enum Mode {
+		ExistingFile,//!< A single, existings file
+		ExistingFolder,//!< A single, existing directory
+		AnyFile,//!< A single, valid file, no matter if exisiting or not (the directory, however, must exist)
+		ExistingFiles//!< Any number of existing files, separated by QPathValidation::pathSeparator
+	};
+
+	//! Describes the result of a validation. Except for Unverified, the values are the same as for QValidator::State
+	enum State {
+		Invalid,//!< The path can't become valid, because it's directory does not exist
+		Intermediate,//!< The path is not valid, but could become valid by editing it
+		Acceptable,//!< The path is valid
+		Unverified//!< The path could not be checked, because it's filesystem did not respond in time
+	};
+
+	//! Creates a validation for the given mode
+	explicit QPathValidation(Mode mode = ExistingFile, bool allowEmptyPath = true);
+
+	//! Returns the kind of path to be validated
+	Mode mode() const;
+	//! Returns whether an empty path is valid or not
+	bool isEmptyPathAllowed() const;
+	//! Returns the name filters paths must match
+	QStringList nameFilters() const;
+	//! Returns the character that separates multiple paths in the QPathValidation::ExistingFiles mode
+	QChar pathSeparator() const;
+	//! Returns the filesystem the paths are checked against
+	QSharedPointer<QPathFileSystemProvider> fileSystemProvider() const;
+
+	//! Sets the kind of path to be validated
+	void setMode(Mode mode);
+	//! Sets whether an empty path is valid or not
+	void setAllowEmptyPath(bool allowEmptyPath);
+	//! Sets the name filters paths must match
+	void setNameFilters(const QStringList &nameFilters);
+	//! Sets the character that separates multiple paths in the QPathValidation::ExistingFiles mode
+	void setPathSeparator(QChar pathSeparator);
+	//! Sets the filesystem the paths are checked against
+	void setFileSystemProvider(const QSharedPointer<QPathFileSystemProvider> &provider);
+
+	//! Validates a single path
+	State validate(const QString &path) const;
+	//! Validates all paths concurrently and waits for the results
+	QVector<State> validate(const QStringList &paths) const;
+	//! Validates all paths concurrently and returns immediately
+	QFuture<State> validateConcurrent(const QStringList &paths) const;
+
+	//! Returns the time in milliseconds a single filesystem check may take
+	static int statDeadline();
+	//! Sets the time in milliseconds a single filesystem check may take
+	static void setStatDeadline(int msecs);
+
+private:
+	Mode validationMode;
+	bool allowEmpty;
+	QStringList nameFilterList;
+	QSharedPointer<const NameFilterMatcher> filterMatcher;
+	QChar separator;
+	QSharedPointer<QPathFileSystemProvider> fsProvider;
+};
+
+#endif // QPATHVALIDATION_H
@@ -0,0 +1,252 @@
+#ifndef QPATHVALIDATION_P_H
+#define QPATHVALIDATION_P_H
+
+#include "qpathvalidation.h"
+#include "qpatheditstatistics.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSemaphore>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringRef>
+#include <QQueue>
+#include <QThreadPool>
+#include <QVector>
+
+#include <list>
+
+Q_DECLARE_LOGGING_CATEGORY(qpatheditPerformance)
+
+class PerformanceCounters
+{
+public:
+	PerformanceCounters();
+
+	static PerformanceCounters *global();
+	static void count(PerformanceCounters *local, QPathEditStatistics::Counter counter);
+	static void time(PerformanceCounters *local, QPathEditStatistics::Timing timing, qint64 nsecs);
+
+	QPathEditStatistics snapshot() const;
+	void reset();
+
+private:
+	QAtomicInteger<quint64> counters[QPathEditStatistics::CounterCount];
+	QAtomicInteger<quint64> totals[QPathEditStatistics::TimingCount];
+	QAtomicInteger<quint64> buckets[QPathEditStatistics::TimingCount][QPathEditStatistics::BucketCount];
+};
+
+typedef QSharedPointer<PerformanceCounters> PerformanceCountersPtr;
+
+class NameFilterMatcher
+{
+public:
+	NameFilterMatcher(const QStringList &nameFilters = QStringList());
+
+	bool isEmpty() const;
+	bool matches(const QString &fileName) const;
+	bool matches(const QStringRef &fileName) const;
+
+private:
+	bool empty;
+	bool matchAll;
+	QMultiHash<uint, QString> suffixes;
+	QList<QRegularExpression> wildcards;
+
+	static uint suffixHash(uint hash, QChar c);
+	static QString wildcardToRegularExpression(const QString &pattern);
+};
+
+typedef QSharedPointer<const NameFilterMatcher> NameFilterMatcherPtr;
+
+struct FileIdentity
+{
+	quint64 device;
+	quint64 inode;
+	qint64 modified;
+	qint64 size;
+};
+
+struct PathStat
+{
+	bool exists;
+	bool isFile;
+	bool isDir;
+	bool verified;
+	FileIdentity file;
+};
+
+class NormalizedPath
+{
+public:
+	explicit NormalizedPath(const QString &path = QString());
+	const QString &toString() const;
+	QStringRef fileName() const;
+	QStringRef directoryPrefix() const;
+
+	static bool isAbsolute(const QString &path);
+
+private:
+	QString path;
+};
+
+class PathStatCache : public QObject
+{
+	Q_OBJECT
+
+public:
+	PathStatCache();
+
+	static PathStatCache *instance();
+
+	PathStat stat(const QString &path, PerformanceCounters *counters = nullptr);
+
+	int timeout() const;
+	void setTimeout(int msecs);
+	int maxSize() const;
+	void setMaxSize(int size);
+	int deadline() const;
+	void setDeadline(int msecs);
+	quint64 epoch() const;
+	bool isSlowMount(const QString &path);
+
+	void watch(const QString &dirPath);
+	void unwatch(const QString &dirPath);
+
+signals:
+	void directoryChanged(const QString &dirPath);
+
+private slots:
+	void watchDirectory(const QString &dirPath);
+	void unwatchDirectory(const QString &dirPath);
+	void invalidateDirectory(const QString &dirPath);
+
+private:
+	struct Entry {
+		PathStat stat;
+		qint64 timestamp;
+		QString dirPath;
+		std::list<QString>::iterator lruPos;
+	};
+
+	struct PendingStat {
+		QSemaphore done;
+		QAtomicInt state;
+		PathStat result;
+	};
+
+	mutable QMutex mutex;
+	QElapsedTimer clock;
+	int ttl;
+	int size;
+	int statDeadline;
+	QHash<QString, Entry> entries;
+	std::list<QString> lru;
+	QHash<QString, int> dirRefs;
+	QSet<QString> unwatchedDirs;
+	QFileSystemWatcher *watcher;
+	QStringList mountPoints;
+	QSet<QString> remoteMounts;
+	qint64 mountsTimestamp;
+	QHash<QString, qint64> slowMounts;
+	QSet<QString> slowHistory;
+	QHash<QString, int> hungStats;
+	QAtomicInteger<quint64> changeEpoch;
+
+	PathStat statWithDeadline(const QString &path, const QString &mountPoint, int msecs);
+	QString mountPoint(const QString &path);
+	bool isRemoteMount(const QString &mountPoint) const;
+	void setMountSlow(const QString &mountPoint, bool slow);
+	void addHungStat(const QString &mountPoint, int delta);
+	void removeEntry(QHash<QString, Entry>::iterator it);
+	void releaseDirectory(const QString &dirPath);
+
+	static PathStat statPath(const QString &path);
+	static QStringList readMountPoints(QSet<QString> &remoteMounts);
+};
+
+class PrefixMemo
+{
+public:
+	PrefixMemo();
+
+	bool isConfirmed(const QStringRef &prefix) const;
+	void confirm(const QStringRef &prefix, quint64 checkedEpoch);
+
+private:
+	mutable QMutex mutex;
+	QString confirmedPrefix;
+	quint64 epoch;
+	QElapsedTimer timer;
+	qint64 validFor;
+};
+
+class MimeTypeCache
+{
+public:
+	MimeTypeCache();
+
+	static MimeTypeCache *instance();
+
+	QString mimeType(const QString &path);
+	bool matches(const QString &path, const QStringList &mimeFilters);
+
+private:
+	struct FileKey {
+		quint64 device;
+		quint64 inode;
+		qint64 modified;
+		qint64 size;
+		QString path;
+
+		bool operator==(const FileKey &other) const;
+	};
+	friend uint qHash(const FileKey &key, uint seed);
+
+	QMutex mutex;
+	QHash<FileKey, QString> mimeTypes;
+	QQueue<FileKey> order;
+
+	static FileKey fileKey(const QString &path, const FileIdentity &file);
+};
+
+class PathChecker
+{
+public:
+	static QThreadPool *threadPool();
+
+	static QPathValidation::State checkPath(const QString &text,
+											QPathValidation::Mode mode,
+											bool allowEmpty,
+											const NameFilterMatcherPtr &matcher,
+											const QPathFileSystemProvider *provider,
+											PerformanceCounters *counters = nullptr,
+											PrefixMemo *memo = nullptr);
+	static QVector<QPathValidation::State> checkPaths(const QStringList &paths,
+													  QPathValidation::Mode mode,
+													  bool allowEmpty,
+													  const NameFilterMatcherPtr &matcher,
+													  const QPathFileSystemProvider *provider,
+													  PerformanceCounters *counters = nullptr);
+	static QPathValidation::State combineStates(const QVector<QPathValidation::State> &states,
+												QPathValidation::Mode mode,
+												bool allowEmpty);
+	static QStringList splitPaths(const QString &text, QChar separator);
+	static PathStat stat(const QString &path, const QPathFileSystemProvider *provider, PerformanceCounters *counters);
+
+private:
+	static QPathValidation::State checkPathState(const QString &text,
+												 QPathValidation::Mode mode,
+												 bool allowEmpty,
+												 const NameFilterMatcherPtr &matcher,
+												 const QPathFileSystemProvider *provider,
+												 PerformanceCounters *counters,
+												 PrefixMemo *memo);
+};
+
+#endif // QPATHVALIDATION_P_H
@@ -1,9 +1,10 @@
-CONFIG *= C++11
+include($$PWD/qpathvalidation.pri)
 
-HEADERS += $$PWD/QPathEdit/qpathedit.h
-SOURCES += $$PWD/QPathEdit/qpathedit.cpp
-
-INCLUDEPATH += $$PWD/QPathEdit
+HEADERS += $$PWD/QPathEdit/qpathedit.h \
+	$$PWD/QPathEdit/qpathedit_p.h \
+	$$PWD/QPathEdit/qpatheditdelegate.h
+SOURCES += $$PWD/QPathEdit/qpathedit.cpp \
+	$$PWD/QPathEdit/qpatheditdelegate.cpp
 
 TRANSLATIONS += $$PWD/qpathedit_de.ts \
 	$$PWD/qpathedit_template.ts
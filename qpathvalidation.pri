@@ -0,0 +1,13 @@
+CONFIG *= C++11
+
+QT *= concurrent
+
+HEADERS += $$PWD/QPathEdit/qpathvalidation.h \
+	$$PWD/QPathEdit/qpathvalidation_p.h \
+	$$PWD/QPathEdit/qpatheditstatistics.h \
+	$$PWD/QPathEdit/qpathfilesystemprovider.h
+SOURCES += $$PWD/QPathEdit/qpathvalidation.cpp \
+	$$PWD/QPathEdit/qpatheditstatistics.cpp \
+	$$PWD/QPathEdit/qpathfilesystemprovider.cpp
+
+INCLUDEPATH += $$PWD/QPathEdit